@@ -0,0 +1,649 @@
+/*
+FILENAME...     ANC150Bench.cpp
+USAGE...        Performance benchmark for the attocube ANC150 motor driver.
+
+*/
+
+/*
+ * benchANC150(portName, nCycles, fileName) exercises an ANC150Controller that
+ * has already been created with ANC150CreateController() and writes the
+ * results as one JSON object to fileName (stdout if empty):
+ *
+ *   pollCycle        - duration of ANC150Controller::poll() with the cached state
+ *                      of the first 1..numAxes axes invalidated
+ *   moveToDone       - time from ANC150Axis::move() of axis 0 (+/-10 steps) to
+ *                      motorStatusDone = 1
+ *   stopDuringPoll   - time to take the controller lock and complete
+ *                      ANC150Axis::stop() while full polls run back to back
+ *   lockDuringPoll   - time to take the controller lock (as any parameter write
+ *                      must) while full polls run back to back
+ *   timeoutsDuringPoll - stop and lock latency as above with one command of
+ *                      every cycle left unanswered by the simulator
+ *                      (ANC150SimTimeouts), against the short I/O timeout;
+ *                      withinBound is false if a stop took longer than
+ *                      ANC150_BENCH_TIMEOUT_BOUND I/O timeouts or a lock
+ *                      took ANC150_BENCH_LOCK_BOUND I/O timeouts or longer;
+ *                      no I/O is done with the controller lock held.  null unless
+ *                      the controller is connected to ANC150SimConfig
+ *   commandsPerSecond - sustained "getf" rate, single commands and pipelined bursts
+ *   notInControl     - pipelined "getf" bursts that alternate between the
+ *                      last axis, taken out of computer control mode
+ *                      (ANC150SimControlMode), and the first; each error frame
+ *                      is followed by a trailing frame that must be discarded
+ *                      without losing the replies after it.  null unless the
+ *                      controller is connected to ANC150SimConfig
+ *   framesPerSecond  - ANC150ParseFrame() + ANC150ParseReply() rate over a set of
+ *                      recorded reply frames; no I/O
+ *
+ * Times are in seconds.  Axis 0 is moved, so this is intended to be run
+ * against the simulator (ANC150SimConfig) or a controller whose stages are
+ * free to move a few steps.  The poller is paused while the benchmark calls
+ * poll() itself.  Rates and means of measurements without samples are 0.
+ *
+ * benchANC150Scale(nWorkers, seconds, fileName) measures how the pollers scale
+ * with the number of controllers.  It creates simulated controllers as it
+ * goes, 1, then 10, then 50, and at each size keeps every axis of every
+ * controller making short moves for the given time.  It reports the achieved
+ * moving poll period, the poll jitter and overruns per controller, and the
+ * lateness of the poller pool.  If nWorkers > 0 and no pool exists yet, a
+ * pool of nWorkers is created first; otherwise each controller gets its own
+ * poller thread.  Run it in separate IOCs to compare the two.  The simulated
+ * controllers are not removed, so both commands are built into the
+ * AttocubeBench library (devAttocubeBench.dbd) for test IOCs only.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
+#include <epicsStdio.h>
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include "ANC150PollerPool.h"
+#include <epicsExport.h>
+
+#define ANC150_BENCH_MOVE_STEPS 10
+#define ANC150_BENCH_MOVE_TIMEOUT 10.0
+#define ANC150_BENCH_PARSE_REPEAT 1000  /* Frame set parses per cycle */
+#define ANC150_BENCH_TIMEOUT_BOUND 3    /* I/O timeouts a stop may wait: two poll bursts and its own */
+#define ANC150_BENCH_LOCK_BOUND 1       /* I/O timeouts the controller lock must take less than */
+
+#define ANC150_BENCH_SCALE_MAX 50       /* Controllers created by benchANC150Scale */
+#define ANC150_BENCH_SCALE_AXES 3
+#define ANC150_BENCH_SCALE_BAUD 115200
+#define ANC150_BENCH_SCALE_MOVING 50    /* Moving poll period (ms) */
+#define ANC150_BENCH_SCALE_IDLE 1000    /* Idle poll period (ms) */
+#define ANC150_BENCH_SCALE_STEPS 200    /* Steps per move; 0.2 sec at the simulator's 1000 Hz */
+
+static const int scaleSizes[] = {1, 10, ANC150_BENCH_SCALE_MAX};
+#define NUM_SCALE_SIZES ((int)(sizeof(scaleSizes) / sizeof(scaleSizes[0])))
+
+extern "C" int ANC150SimConfig(const char *portName, int numAxes, int baud);
+extern "C" int ANC150SimTimeouts(const char *portName, int count);
+extern "C" int ANC150SimControlMode(const char *portName, int axis, int enable);
+extern "C" int ANC150CreateController(const char *portName, const char *ANC150PortName, int numAxes,
+                                      int movingPollPeriod, int idlePollPeriod, int verifyPollPeriod,
+                                      int publishPeriod);
+extern "C" int ANC150CreatePollerPool(int nWorkers);
+
+/* Reply frames as read up to the "> " prompt, paired with their commands. */
+static const char *benchFrames[][2] = {
+  {"getf 1", "getf 1\r\nfrequency = 1000\r\nOK\r\n"},
+  {"getm 1", "getm 1\r\nmode = stp\r\nOK\r\n"},
+  {"getm 2", "getm 2\r\nmode = gnd\r\nOK\r\n"},
+  {"getf 3", "getf 3\r\nAxis not in computer control mode\r\nERROR\r\n"},
+  {"stepu 1 10", "stepu 1 10\r\n\r\nOK\r\n"},
+  {"ver", "ver\r\nattocube ANC150 v. 1.0.0\r\nOK\r\n"},
+};
+#define NUM_BENCH_FRAMES ((int)(sizeof(benchFrames) / sizeof(benchFrames[0])))
+
+/* Keeps the parse loop from being optimized away. */
+static volatile int benchSink;
+
+/** Returns count / seconds, or 0 if no time was measured, so the JSON has no inf or nan. */
+static double benchRate(double count, double seconds)
+{
+  return((seconds > 0.0) ? count / seconds : 0.0);
+}
+
+/** Running statistics of a series of durations. */
+class ANC150BenchStats {
+public:
+  ANC150BenchStats() : n_(0), sum_(0.0), min_(0.0), max_(0.0) {}
+  void add(double t)
+  {
+    if (n_ == 0 || t < min_) min_ = t;
+    if (n_ == 0 || t > max_) max_ = t;
+    sum_ += t;
+    n_++;
+  }
+  double max() const { return max_; }
+  void print(FILE *fp)
+  {
+    fprintf(fp, "{\"n\": %d, \"mean\": %g, \"min\": %g, \"max\": %g}",
+            n_, n_ ? sum_ / n_ : 0.0, min_, max_);
+  }
+private:
+  int n_;
+  double sum_;
+  double min_;
+  double max_;
+};
+
+class ANC150Bench {
+public:
+  ANC150Bench(ANC150Controller *pC, int nCycles, FILE *fp);
+  void run();
+  void busyPoll();
+  static bool scale(int nWorkers, double seconds, FILE *fp);
+
+private:
+  void pollCycles();
+  void moveToDone();
+  void duringPoll(bool timeouts);
+  void commandRate();
+  void notInControl();
+  void parseRate();
+
+  ANC150Controller *pC_;
+  int nCycles_;
+  FILE *fp_;
+  int doneParam_;             /* motorStatusDone */
+  volatile bool busy_;
+  epicsEventId busyDone_;
+};
+
+ANC150Bench::ANC150Bench(ANC150Controller *pC, int nCycles, FILE *fp)
+  : pC_(pC), nCycles_(nCycles), fp_(fp), doneParam_(-1), busy_(false)
+{
+  pC_->findParam(motorStatusDoneString, &doneParam_);
+}
+
+void ANC150Bench::pollCycles()
+{
+  int nAxes, i;
+  epicsTime start;
+
+  pC_->pausePoller(true);
+  fprintf(fp_, "  \"pollCycle\": [");
+  for (nAxes=1; nAxes<=pC_->numAxes(); nAxes++) {
+    ANC150BenchStats stats;
+
+    for (i=0; i<nCycles_; i++) {
+      pC_->lock();
+      pC_->invalidateCache(nAxes);
+      start = epicsTime::getCurrent();
+      pC_->poll();
+      stats.add(epicsTime::getCurrent() - start);
+      pC_->unlock();
+    }
+    fprintf(fp_, "%s\n    {\"axes\": %d, \"time\": ", (nAxes > 1) ? "," : "", nAxes);
+    stats.print(fp_);
+    fprintf(fp_, "}");
+  }
+  fprintf(fp_, "\n  ],\n");
+  pC_->pausePoller(false);
+}
+
+void ANC150Bench::moveToDone()
+{
+  ANC150BenchStats stats;
+  ANC150Axis *pAxis = pC_->getAxis(0);
+  epicsTime start;
+  asynStatus status;
+  int done, i;
+
+  for (i=0; i<nCycles_; i++) {
+    pC_->lock();
+    start = epicsTime::getCurrent();
+    status = pAxis->move((i % 2) ? -ANC150_BENCH_MOVE_STEPS : ANC150_BENCH_MOVE_STEPS, 1, 0., 0., 0.);
+    pAxis->setIntegerParam(doneParam_, 0);
+    pAxis->callParamCallbacks();
+    pC_->unlock();
+    if (status != asynSuccess)
+      continue;
+    pC_->wakeupPoller();
+
+    do {
+      epicsThreadSleep(0.001);
+      pC_->lock();
+      pC_->getIntegerParam(0, doneParam_, &done);
+      pC_->unlock();
+    } while (!done && epicsTime::getCurrent() - start < ANC150_BENCH_MOVE_TIMEOUT);
+    if (done)
+      stats.add(epicsTime::getCurrent() - start);
+  }
+  fprintf(fp_, "  \"moveToDone\": ");
+  stats.print(fp_);
+  fprintf(fp_, ",\n");
+}
+
+/** Runs full polls back to back until busy_ is cleared. */
+void ANC150Bench::busyPoll()
+{
+  while (busy_) {
+    pC_->lock();
+    pC_->invalidateCache(pC_->numAxes());
+    pC_->poll();
+    pC_->unlock();
+    epicsThreadSleep(0.0);
+  }
+  epicsEventSignal(busyDone_);
+}
+
+static void busyPollC(void *pPvt)
+{
+  ANC150Bench *pBench = (ANC150Bench *) pPvt;
+  pBench->busyPoll();
+}
+
+/** Measures stop, lock and snapshot latency while full polls run back to back.
+  * \param[in] timeouts Leave one command of every cycle unanswered; the
+  *                     controller must be connected to the simulator. */
+void ANC150Bench::duringPoll(bool timeouts)
+{
+  ANC150BenchStats stopStats, lockStats, snapshotStats;
+  ANC150Axis *pAxis = pC_->getAxis(0);
+  ANC150AxisSnapshot snapshot;
+  ANC150Stats stats;
+  epicsTime start;
+  double ioTimeout;
+  int timeoutsBefore, injected = 0;
+  int i;
+
+  if (timeouts && ANC150SimTimeouts(pC_->ioPortName(), 0) != asynSuccess) {
+    fprintf(fp_, "  \"timeoutsDuringPoll\": null,\n");
+    return;
+  }
+  pC_->readStats(&stats);
+  timeoutsBefore = stats.timeouts;
+
+  pC_->pausePoller(true);
+  busy_ = true;
+  busyDone_ = epicsEventMustCreate(epicsEventEmpty);
+  epicsThreadCreate("ANC150Bench", epicsThreadPriorityMedium,
+                    epicsThreadGetStackSize(epicsThreadStackMedium),
+                    (EPICSTHREADFUNC) busyPollC, this);
+
+  for (i=0; i<nCycles_; i++) {
+    epicsThreadSleep(0.003 * (i % 7));
+    /* The dropped command is whichever is sent next: a poll burst or the stop. */
+    if (timeouts && ANC150SimTimeouts(pC_->ioPortName(), 1) == asynSuccess)
+      injected++;
+    start = epicsTime::getCurrent();
+    pAxis->readSnapshot(&snapshot);
+    snapshotStats.add(epicsTime::getCurrent() - start);
+    start = epicsTime::getCurrent();
+    pC_->lock();
+    lockStats.add(epicsTime::getCurrent() - start);
+    pAxis->stop(0.);
+    stopStats.add(epicsTime::getCurrent() - start);
+    pC_->unlock();
+  }
+
+  busy_ = false;
+  epicsEventWait(busyDone_);
+  epicsEventDestroy(busyDone_);
+  pC_->pausePoller(false);
+
+  if (timeouts) {
+    ANC150SimTimeouts(pC_->ioPortName(), 0);
+    ioTimeout = pC_->maxTimeout();
+    pC_->readStats(&stats);
+    fprintf(fp_, "  \"timeoutsDuringPoll\": {\"ioTimeout\": %g, \"injected\": %d, \"timeouts\": %d, \"stop\": ",
+            ioTimeout, injected, stats.timeouts - timeoutsBefore);
+    stopStats.print(fp_);
+    fprintf(fp_, ", \"lock\": ");
+    lockStats.print(fp_);
+    fprintf(fp_, ", \"withinBound\": %s},\n",
+            (stopStats.max() <= ANC150_BENCH_TIMEOUT_BOUND * ioTimeout &&
+             lockStats.max() < ANC150_BENCH_LOCK_BOUND * ioTimeout) ? "true" : "false");
+    return;
+  }
+
+  fprintf(fp_, "  \"stopDuringPoll\": ");
+  stopStats.print(fp_);
+  fprintf(fp_, ",\n  \"lockDuringPoll\": ");
+  lockStats.print(fp_);
+  fprintf(fp_, ",\n  \"snapshotDuringPoll\": ");
+  snapshotStats.print(fp_);
+  fprintf(fp_, ",\n");
+}
+
+void ANC150Bench::commandRate()
+{
+  ANC150Command cmds[ANC150_MAX_PIPELINE];
+  epicsTime start;
+  double single, pipelined;
+  int i;
+
+  start = epicsTime::getCurrent();
+  for (i=0; i<nCycles_; i++) {
+    strcpy(cmds[0].command, "getf 1");
+    pC_->sendCommands(cmds, 1);
+  }
+  single = benchRate(nCycles_, epicsTime::getCurrent() - start);
+
+  start = epicsTime::getCurrent();
+  for (i=0; i<nCycles_; i++) {
+    for (int j=0; j<ANC150_MAX_PIPELINE; j++)
+      sprintf(cmds[j].command, "getf %d", (j % pC_->numAxes()) + 1);
+    pC_->sendCommands(cmds, ANC150_MAX_PIPELINE);
+  }
+  pipelined = benchRate(nCycles_ * ANC150_MAX_PIPELINE, epicsTime::getCurrent() - start);
+
+  fprintf(fp_, "  \"commandsPerSecond\": {\"single\": %g, \"pipelined\": %g},\n", single, pipelined);
+}
+
+void ANC150Bench::notInControl()
+{
+  ANC150BenchStats stats;
+  ANC150Command cmds[ANC150_MAX_PIPELINE];
+  ANC150Stats before, after;
+  epicsTime start;
+  int lastAxis = pC_->numAxes();
+  int answered = 0, expected = 0;
+  int i, j;
+
+  if (lastAxis < 2 || ANC150SimControlMode(pC_->ioPortName(), lastAxis, 0) != asynSuccess) {
+    fprintf(fp_, "  \"notInControl\": null,\n");
+    return;
+  }
+  pC_->readStats(&before);
+
+  for (i=0; i<nCycles_; i++) {
+    for (j=0; j<ANC150_MAX_PIPELINE; j++)
+      sprintf(cmds[j].command, "getf %d", (j % 2) ? 1 : lastAxis);
+    start = epicsTime::getCurrent();
+    pC_->sendCommands(cmds, ANC150_MAX_PIPELINE);
+    stats.add(epicsTime::getCurrent() - start);
+    for (j=0; j<ANC150_MAX_PIPELINE; j++) {
+      expected++;
+      if (cmds[j].status == asynSuccess &&
+          cmds[j].result.code == ((j % 2) ? ANC150ResultOK : ANC150ResultNotInControl))
+        answered++;
+    }
+  }
+  ANC150SimControlMode(pC_->ioPortName(), lastAxis, 1);
+
+  pC_->readStats(&after);
+  fprintf(fp_, "  \"notInControl\": {\"replies\": %d, \"expected\": %d, \"discards\": %d, \"burst\": ",
+          answered, expected, after.discards - before.discards);
+  stats.print(fp_);
+  fprintf(fp_, "},\n");
+}
+
+void ANC150Bench::parseRate()
+{
+  const ANC150CommandDef *defs[NUM_BENCH_FRAMES];
+  size_t lens[NUM_BENCH_FRAMES];
+  ANC150Frame frame;
+  ANC150Result result;
+  epicsTime start;
+  long nFrames = 0;
+  int i, j, k;
+
+  for (k=0; k<NUM_BENCH_FRAMES; k++) {
+    defs[k] = ANC150FindCommand(benchFrames[k][0]);
+    lens[k] = strlen(benchFrames[k][1]);
+  }
+
+  start = epicsTime::getCurrent();
+  for (i=0; i<nCycles_; i++) {
+    for (j=0; j<ANC150_BENCH_PARSE_REPEAT; j++) {
+      for (k=0; k<NUM_BENCH_FRAMES; k++) {
+        if (ANC150ParseFrame(benchFrames[k][1], lens[k], &frame) == 0 ||
+            !ANC150ViewEquals(&frame.echo, benchFrames[k][0]))
+          continue;
+        ANC150ParseReply(defs[k], &frame, &result);
+        benchSink = result.value;
+        nFrames++;
+      }
+    }
+  }
+  fprintf(fp_, "  \"framesPerSecond\": %g\n", benchRate(nFrames, epicsTime::getCurrent() - start));
+}
+
+void ANC150Bench::run()
+{
+  fprintf(fp_, "{\n  \"port\": \"%s\",\n  \"numAxes\": %d,\n  \"cycles\": %d,\n",
+          pC_->portName, pC_->numAxes(), nCycles_);
+  pollCycles();
+  moveToDone();
+  duringPoll(false);
+  duringPoll(true);
+  commandRate();
+  notInControl();
+  parseRate();
+  fprintf(fp_, "}\n");
+  fflush(fp_);
+}
+
+/** Creates simulated controllers up to nControllers.
+  * \param[in,out] pControllers The controllers created so far.
+  * \param[in] nControllers The number of controllers wanted.
+  * \return The number of controllers. */
+static int scaleControllers(ANC150Controller **pControllers, int nControllers)
+{
+  static int nCreated = 0;
+  char simName[32], name[32];
+
+  for (; nCreated<nControllers; nCreated++) {
+    epicsSnprintf(simName, sizeof(simName), "ANC150ScaleSim%d", nCreated);
+    epicsSnprintf(name, sizeof(name), "ANC150Scale%d", nCreated);
+    if (ANC150SimConfig(simName, ANC150_BENCH_SCALE_AXES, ANC150_BENCH_SCALE_BAUD) != asynSuccess ||
+        ANC150CreateController(name, simName, ANC150_BENCH_SCALE_AXES, ANC150_BENCH_SCALE_MOVING,
+                               ANC150_BENCH_SCALE_IDLE, 0, 0) != asynSuccess)
+      break;
+    pControllers[nCreated] = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(name));
+    if (!pControllers[nCreated])
+      break;
+  }
+  return(nCreated);
+}
+
+/** Runs the poller scaling measurement.
+  * \param[in] nWorkers The size of the poller pool to create; 0 for a thread per controller.
+  * \param[in] seconds The time the controllers move at each size.
+  * \param[in] fp The file the JSON results are written to.
+  * \return false if the controllers could not be created. */
+bool ANC150Bench::scale(int nWorkers, double seconds, FILE *fp)
+{
+  static ANC150Controller *pControllers[ANC150_BENCH_SCALE_MAX];
+  ANC150Controller *pC;
+  ANC150Axis *pAxis;
+  ANC150PollerPool *pPool;
+  ANC150Stats stats;
+  int polls[ANC150_BENCH_SCALE_MAX], overruns[ANC150_BENCH_SCALE_MAX];
+  int direction[ANC150_BENCH_SCALE_MAX][ANC150_BENCH_SCALE_AXES];
+  epicsTime start;
+  double elapsed;
+  int size, n, i, axis, done, doneParam, moves, totalOverruns;
+
+  if (nWorkers > 0 && !ANC150PollerPool::defaultPool)
+    ANC150CreatePollerPool(nWorkers);
+  pPool = ANC150PollerPool::defaultPool;
+
+  fprintf(fp, "{\n  \"pollerThreads\": \"%s\",\n  \"workers\": %d,\n  \"movingPollPeriod\": %g,\n"
+          "  \"seconds\": %g,\n  \"sizes\": [", pPool ? "pool" : "per controller", pPool ? pPool->numWorkers() : 0,
+          ANC150_BENCH_SCALE_MOVING / 1000., seconds);
+  for (size=0; size<NUM_SCALE_SIZES; size++) {
+    ANC150BenchStats period, jitter;
+
+    n = scaleSizes[size];
+    if (scaleControllers(pControllers, n) < n) {
+      fprintf(fp, "\n  ]\n}\n");
+      return(false);
+    }
+    for (i=0; i<n; i++) {
+      pC = pControllers[i];
+      pC->readStats(&stats);
+      polls[i] = stats.polls;
+      overruns[i] = stats.pollOverruns;
+      for (axis=0; axis<ANC150_BENCH_SCALE_AXES; axis++)
+        direction[i][axis] = 1;
+    }
+    /* Controllers just created are still making their startup handshake. */
+    start = epicsTime::getCurrent();
+    for (i=0; i<n; i++) {
+      pC = pControllers[i];
+      pC->lock();
+      while (!pC->ready() && epicsTime::getCurrent() - start < ANC150_BENCH_MOVE_TIMEOUT) {
+        pC->unlock();
+        epicsThreadSleep(0.01);
+        pC->lock();
+      }
+      pC->unlock();
+    }
+    if (pPool)
+      pPool->resetStats();
+
+    moves = 0;
+    start = epicsTime::getCurrent();
+    while (epicsTime::getCurrent() - start < seconds) {
+      for (i=0; i<n; i++) {
+        pC = pControllers[i];
+        pC->findParam(motorStatusDoneString, &doneParam);
+        pC->lock();
+        for (axis=0; axis<ANC150_BENCH_SCALE_AXES; axis++) {
+          done = 0;
+          pC->getIntegerParam(axis, doneParam, &done);
+          if (!done) continue;
+          pAxis = pC->getAxis(axis);
+          direction[i][axis] = -direction[i][axis];
+          if (pAxis->move(direction[i][axis] * ANC150_BENCH_SCALE_STEPS, 1, 0., 0., 0.) != asynSuccess)
+            continue;
+          pAxis->setIntegerParam(doneParam, 0);
+          pAxis->callParamCallbacks();
+          moves++;
+        }
+        pC->unlock();
+        pC->wakeupPoller();
+      }
+      epicsThreadSleep(0.01);
+    }
+    elapsed = epicsTime::getCurrent() - start;
+
+    totalOverruns = 0;
+    for (i=0; i<n; i++) {
+      pC = pControllers[i];
+      pC->readStats(&stats);
+      if (stats.polls > polls[i])
+        period.add(elapsed / (stats.polls - polls[i]));
+      jitter.add(stats.pollJitter);
+      totalOverruns += stats.pollOverruns - overruns[i];
+    }
+
+    fprintf(fp, "%s\n    {\"controllers\": %d, \"moves\": %d, \"pollPeriod\": ", size ? "," : "", n, moves);
+    period.print(fp);
+    fprintf(fp, ", \"pollJitter\": ");
+    jitter.print(fp);
+    fprintf(fp, ", \"pollOverruns\": %d", totalOverruns);
+    if (pPool)
+      fprintf(fp, ", \"poolLateness\": {\"mean\": %g, \"max\": %g}", pPool->meanLateness(), pPool->maxLateness());
+    fprintf(fp, "}");
+    fflush(fp);
+  }
+  fprintf(fp, "\n  ]\n}\n");
+  return(true);
+}
+
+/** Runs the benchmark against an existing ANC150 controller.
+  * \param[in] portName The asyn port name given to ANC150CreateController
+  * \param[in] nCycles  The number of repetitions of each measurement
+  * \param[in] fileName The file the JSON results are written to; stdout if NULL or empty
+  */
+extern "C" int benchANC150(const char *portName, int nCycles, const char *fileName)
+{
+  ANC150Controller *pC;
+  FILE *fp = stdout;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("benchANC150: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  if (nCycles < 1)
+    nCycles = 100;
+  if (fileName && fileName[0]) {
+    fp = fopen(fileName, "w");
+    if (!fp) {
+      printf("benchANC150: cannot open %s\n", fileName);
+      return(asynError);
+    }
+  }
+
+  ANC150Bench bench(pC, nCycles, fp);
+  bench.run();
+
+  if (fp != stdout)
+    fclose(fp);
+  return(asynSuccess);
+}
+
+/** Measures how the pollers scale with 1, 10 and 50 simulated controllers.
+  * \param[in] nWorkers The size of the poller pool to create; 0 for a poller thread per controller
+  * \param[in] seconds  The time in seconds the controllers move at each size
+  * \param[in] fileName The file the JSON results are written to; stdout if NULL or empty
+  */
+extern "C" int benchANC150Scale(int nWorkers, double seconds, const char *fileName)
+{
+  FILE *fp = stdout;
+  bool ok;
+
+  if (seconds <= 0.0)
+    seconds = 10.0;
+  if (fileName && fileName[0]) {
+    fp = fopen(fileName, "w");
+    if (!fp) {
+      printf("benchANC150Scale: cannot open %s\n", fileName);
+      return(asynError);
+    }
+  }
+
+  ok = ANC150Bench::scale(nWorkers, seconds, fp);
+  if (!ok)
+    printf("benchANC150Scale: cannot create the simulated controllers\n");
+
+  if (fp != stdout)
+    fclose(fp);
+  return(ok ? asynSuccess : asynError);
+}
+
+/** Code for iocsh registration */
+static const iocshArg benchANC150Arg0 = {"Port name", iocshArgString};
+static const iocshArg benchANC150Arg1 = {"Number of cycles", iocshArgInt};
+static const iocshArg benchANC150Arg2 = {"Output file", iocshArgString};
+static const iocshArg * const benchANC150Args[] = {&benchANC150Arg0,
+                                                   &benchANC150Arg1,
+                                                   &benchANC150Arg2};
+static const iocshFuncDef benchANC150Def = {"benchANC150", 3, benchANC150Args};
+static void benchANC150CallFunc(const iocshArgBuf *args)
+{
+  benchANC150(args[0].sval, args[1].ival, args[2].sval);
+}
+
+static const iocshArg benchANC150ScaleArg0 = {"Number of pool workers", iocshArgInt};
+static const iocshArg benchANC150ScaleArg1 = {"Seconds per size", iocshArgDouble};
+static const iocshArg benchANC150ScaleArg2 = {"Output file", iocshArgString};
+static const iocshArg * const benchANC150ScaleArgs[] = {&benchANC150ScaleArg0,
+                                                        &benchANC150ScaleArg1,
+                                                        &benchANC150ScaleArg2};
+static const iocshFuncDef benchANC150ScaleDef = {"benchANC150Scale", 3, benchANC150ScaleArgs};
+static void benchANC150ScaleCallFunc(const iocshArgBuf *args)
+{
+  benchANC150Scale(args[0].ival, args[1].dval, args[2].sval);
+}
+
+static void ANC150BenchRegister(void)
+{
+  iocshRegister(&benchANC150Def, benchANC150CallFunc);
+  iocshRegister(&benchANC150ScaleDef, benchANC150ScaleCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150BenchRegister);
+}
@@ -0,0 +1,2224 @@
+/*
+FILENAME...     ANC150Driver.cpp
+USAGE...        Motor driver support (model 3) for the attocube systems AG ANC150
+                Piezo Step Controller.
+
+*/
+
+/*
+ *      Original Author: Ron Sluiter
+ *      Date: 07/24/2008
+ *
+ *      Experimental Physics and Industrial Control System (EPICS)
+ *
+ *      Copyright 1991, the Regents of the University of California,
+ *      and the University of Chicago Board of Governors.
+ *
+ *      This software was produced under  U.S. Government contracts:
+ *      (W-7405-ENG-36) at the Los Alamos National Laboratory,
+ *      and (W-31-109-ENG-38) at Argonne National Laboratory.
+ *
+ * Modification Log:
+ * -----------------
+ * .01 11-09-07 rls copied from drvMM4000Asyn.cc
+ * .02 10-29-08 rls - added frequency and step mode to polling data.
+ *                  - support for CNEN field.
+ *                  - simulate trajectory positon so RDBL link updates.
+ *                  - allow zero moves so motor record does not get stuck.
+ * .03 11-19-08 rls - change input EOS to prompt ">".
+ *                  - support enable/disable "torque".
+ *                  - zero move bug fix.
+ *                  - set firmwareVersion.
+ * .04 02-18-09 rls Copied Matthew Pearson's (Diamond) fix on XPS for;
+ *                  - idle polling interfering with setting position.
+ *                  - auto save/restore not working.
+ * .05 06-11-09 rls - Matthew Pearson's fix for record seeing motorAxisDone True
+ *                  on 1st status update after a move.
+ * .06 08-07-09 rls - bug fix for multi-axis not reading frequency.
+ *                  - bug fix for set position not setting val/dval/rval.
+ * .07 10-17-26     - ported from drvANC150Asyn.cc (model 2) to the
+ *                    asynMotorController/asynMotorAxis (model 3) API.
+ *                  - all axes are polled by a single ANC150Controller::poll()
+ *                    followed by one callback sweep.
+ *                  - frequency and step mode are cached per axis, updated by
+ *                    the driver's own "setm" writes and only re-read from the
+ *                    controller every verifyPollPeriod.
+ *                  - poll does its serial I/O without the controller lock
+ *                    held; transactions are serialized by ioLock_ instead.
+ *                  - pipelined transport; poll queries for all axes are sent
+ *                    as one burst and the replies matched by their echo.
+ *                  - command latency histograms, transport counters and poll
+ *                    timing, published as parameters and in the report.
+ *                  - replies are split and decoded in place by the table
+ *                    driven parser in ANC150Parser.cpp.
+ *                  - profile moves, streamed as timed step bursts by
+ *                    ANC150Profile.cpp.
+ *                  - deferred (coordinated) moves, started in one burst.
+ *                  - moveVelocity steps continuously at a frequency derived
+ *                    from the velocity; soft limits are stored and enforced
+ *                    by the poller.  stop freezes the simulated position.
+ *                  - own poller thread on absolute deadlines; it also wakes
+ *                    when the next move is predicted to complete.
+ *                  - positions of moving axes are published at their own
+ *                    rate, between status polls and without serial I/O.
+ *                  - optional closed-loop approach moves from an external
+ *                    position source, in ANC150Feedback.cpp.
+ *                  - optional poller pool shared by many controllers, in
+ *                    ANC150PollerPool.cpp.
+ *                  - the "ver" handshake and axis initialization run in a
+ *                    thread per controller, so IOC startup does not wait for
+ *                    them; ANC150StartupSummary() reports the time to ready.
+ *                  - link state machine: a controller that stops answering is
+ *                    probed with "ver" at exponentially growing intervals
+ *                    instead of being polled, and its frequency and mode are
+ *                    restored when it answers again.
+ *                  - adaptive I/O timeouts from the measured round trip
+ *                    times, in ANC150Timeout.cpp.
+ *                  - lock-free status snapshot of every axis
+ *                    (ANC150Axis::readSnapshot(), ANC150Status iocsh command).
+ *                  - trace messages of the poll, move and I/O paths go
+ *                    through the asynchronous log in ANC150Log.cpp.
+ *                  - optional memory-mapped position journal, in
+ *                    ANC150Journal.cpp.
+ *                  - moves convert distance to steps with a per-direction,
+ *                    per-frequency step size model, learnt by the approach
+ *                    moves and saved to a file (ANC150StepModel.cpp).
+ *                  - model differences are protocol traits (ANC150Parser.cpp);
+ *                    ANC300 controllers over TCP with ANC300CreateController().
+ *                  - moves step at the frequency of the requested velocity;
+ *                    "setf" is sent with the step command only when the
+ *                    cached frequency changes.
+ *                  - optional latest-wins move mailbox and dispatcher thread,
+ *                    in ANC150Mailbox.cpp; stop drops a pending move.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsAtomic.h>
+#include <epicsString.h>
+#include <epicsStdio.h>
+#include <iocsh.h>
+
+#include <asynOctetSyncIO.h>
+#include <asynOptionSyncIO.h>
+
+#include "ANC150Driver.h"
+#include "ANC150PollerPool.h"
+#include "ANC150Log.h"
+#include <epicsExport.h>
+
+#define NINT(f) (long)((f)>0 ? (f)+0.5 : (f)-0.5)       /* Nearest integer. */
+
+static asynStatus decodeFreq(const ANC150Command *pCmd, int *frequency);
+static bool decodeMode(const ANC150Command *pCmd);
+
+/* Upper edges (sec) of all but the last latency histogram bin. */
+static const double histEdges[ANC150_HIST_BINS - 1] =
+  {0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0};
+static const char *cmdClassNames[ANC150NumCmdClasses] = {"query", "set", "move", "stop"};
+
+static const char *linkNames[] = {"connected", "degraded", "disconnected"};
+
+/* All ANC150 controllers, newest first. */
+static ANC150Controller *pFirstController = NULL;
+
+/** Returns the default shortest I/O timeout of a link: the wire time of a full
+  * ANC150_BUFFER_SIZE frame at the port's baud rate (10 bits per character),
+  * and no less than ANC150_MIN_TIMEOUT.  Ports without a "baud" option, such
+  * as TCP, get ANC150_MIN_TIMEOUT.
+  * \param[in] portName The asyn port connected to the controller. */
+static double linkMinTimeout(const char *portName)
+{
+  asynUser *pasynUser;
+  char value[32];
+  double baud = 0.0, timeout = ANC150_MIN_TIMEOUT;
+
+  if (pasynOptionSyncIO->connect(portName, 0, &pasynUser, NULL) != asynSuccess)
+    return(timeout);
+  if (pasynOptionSyncIO->getOption(pasynUser, "baud", value, sizeof(value), 1.0) == asynSuccess)
+    baud = atof(value);
+  pasynOptionSyncIO->disconnect(pasynUser);
+  if (baud > 0.0 && ANC150_BUFFER_SIZE * 10.0 / baud > timeout)
+    timeout = ANC150_BUFFER_SIZE * 10.0 / baud;
+  return(timeout);
+}
+
+static void ANC150InitC(void *pPvt)
+{
+  ANC150Controller *pC = (ANC150Controller *) pPvt;
+  pC->initThread();
+}
+
+/** Creates a new ANC150Controller object.
+  * The "ver" handshake and axis initialization are made by a thread of the
+  * controller's own, so the constructor returns without waiting for the
+  * controller; until they are complete the axes report a communication error.
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] ANC150PortName    The name of the drvAsynSerialPort that was created previously to connect to the ANC150 controller
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] movingPollPeriod  The time between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time between polls when no axis is moving
+  * \param[in] verifyPollPeriod  The time between re-reads of the cached frequency and mode of each axis
+  * \param[in] publishPeriod     The time between position updates of moving axes; 0 for none
+  * \param[in] pProtocol         The protocol traits of the controller model
+  */
+ANC150Controller::ANC150Controller(const char *portName, const char *ANC150PortName, int numAxes,
+                                   double movingPollPeriod, double idlePollPeriod, double verifyPollPeriod,
+                                   double publishPeriod, const ANC150Protocol *pProtocol)
+  :  asynMotorController(portName, numAxes, NUM_ANC150_PARAMS,
+                         asynInt32ArrayMask, // Latency histograms
+                         0, // No additional callback interfaces beyond those in base class
+                         ASYN_CANBLOCK | ASYN_MULTIDEVICE,
+                         1, // autoconnect
+                         0, 0),  // Default priority and stack size
+     verifyPollPeriod_(verifyPollPeriod), publishPeriod_(publishPeriod), movesDeferred_(false),
+     profileStartEvent_(NULL), profileAbortEvent_(NULL), profileAborted_(false),
+     profileStartTimes_(NULL), pPollerPool_(NULL), pPollerEntry_(NULL), anyMoving_(false),
+     statusPoll_(true), fastPolls_(0), stepModelFile_(NULL), stepModelDirty_(false),
+     ready_(false), timeToReady_(0.0), link_(ANC150LinkConnected), linkFailures_(0),
+     probing_(true), probeDelay_(ANC150_PROBE_MIN)
+{
+  int axis;
+  asynStatus status;
+  char name[64];
+  static const char *functionName = "ANC150Controller::ANC150Controller";
+
+  createTime_ = epicsTime::getCurrent();
+  firmwareVersion_[0] = 0;
+  strncpy(ANC150PortName_, ANC150PortName, sizeof(ANC150PortName_) - 1);
+  ANC150PortName_[sizeof(ANC150PortName_) - 1] = 0;
+  ioLock_ = epicsMutexMustCreate();
+  memset(stats_.histogram, 0, sizeof(stats_.histogram));
+  memset(stats_.latencySum, 0, sizeof(stats_.latencySum));
+  memset(stats_.latencyMax, 0, sizeof(stats_.latencyMax));
+  memset(stats_.count, 0, sizeof(stats_.count));
+  stats_.timeouts = stats_.errors = stats_.discards = stats_.retries = stats_.reconnects = 0;
+  stats_.coalesced = stats_.preempted = 0;
+  stats_.pollOverruns = stats_.polls = 0;
+  stats_.pollTime = stats_.pollPeriod = stats_.pollJitter = 0.0;
+  stats_.groupSkew = 0.0;
+  stats_.havePoll = false;
+  pJournal_ = NULL;
+  pProtocol_ = pProtocol;
+  mailboxEvent_ = NULL;
+  pollerPaused_ = pollerStepping_ = false;
+
+  // Create controller-specific parameters
+  createParam(ANC150CommandsString,     asynParamInt32,      &ANC150Commands_);
+  createParam(ANC150TimeoutsString,     asynParamInt32,      &ANC150Timeouts_);
+  createParam(ANC150ErrorsString,       asynParamInt32,      &ANC150Errors_);
+  createParam(ANC150DiscardsString,     asynParamInt32,      &ANC150Discards_);
+  createParam(ANC150RetriesString,      asynParamInt32,      &ANC150Retries_);
+  createParam(ANC150PollOverrunsString, asynParamInt32,      &ANC150PollOverruns_);
+  createParam(ANC150PollTimeString,     asynParamFloat64,    &ANC150PollTime_);
+  createParam(ANC150PollPeriodString,   asynParamFloat64,    &ANC150PollPeriod_);
+  createParam(ANC150PollJitterString,   asynParamFloat64,    &ANC150PollJitter_);
+  createParam(ANC150QueryHistString,    asynParamInt32Array, &ANC150QueryHist_);
+  createParam(ANC150SetHistString,      asynParamInt32Array, &ANC150SetHist_);
+  createParam(ANC150MoveHistString,     asynParamInt32Array, &ANC150MoveHist_);
+  createParam(ANC150StopHistString,     asynParamInt32Array, &ANC150StopHist_);
+  createParam(ANC150ProfileStartTimesString, asynParamFloat64Array, &ANC150ProfileStartTimes_);
+  createParam(ANC150ProfileMaxLateString, asynParamFloat64,    &ANC150ProfileMaxLate_);
+  createParam(ANC150GroupSkewString,    asynParamFloat64,    &ANC150GroupSkew_);
+  createParam(ANC150LinkStateString,    asynParamInt32,      &ANC150LinkState_);
+  createParam(ANC150ReconnectsString,   asynParamInt32,      &ANC150Reconnects_);
+  createParam(ANC150IoTimeoutString,    asynParamFloat64,    &ANC150IoTimeout_);
+  createParam(ANC150CoalescedString,    asynParamInt32,      &ANC150Coalesced_);
+  createParam(ANC150PreemptedString,    asynParamInt32,      &ANC150Preempted_);
+
+  /* Connect to ANC150 controller */
+  status = pasynOctetSyncIO->connect(ANC150PortName, 0, &pasynUserController_, NULL);
+  if (status) {
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s: cannot connect to ANC150 controller\n",
+      functionName);
+  }
+
+  minTimeout_ = linkMinTimeout(ANC150PortName);
+  ANC150RttInit(&rtt_[ANC150TimeoutShort], minTimeout_, pProtocol_->maxTimeout);
+  ANC150RttInit(&rtt_[ANC150TimeoutLong], minTimeout_, ANC150_LONG_TIMEOUT);
+
+  /* Set command End-of-string */
+  pasynOctetSyncIO->setInputEos(pasynUserController_,  pProtocol_->inEos,  strlen(pProtocol_->inEos));
+  pasynOctetSyncIO->setOutputEos(pasynUserController_, pProtocol_->outEos, strlen(pProtocol_->outEos));
+
+  // Create the axis objects
+  for (axis=0; axis<numAxes; axis++) {
+    new ANC150Axis(this, axis);
+  }
+
+  pNextController_ = pFirstController;
+  pFirstController = this;
+
+  startPoller(movingPollPeriod, idlePollPeriod, 2);
+  epicsSnprintf(name, sizeof(name), "ANC150Init:%s", portName);
+  epicsThreadCreate(name, epicsThreadPriorityMedium,
+                    epicsThreadGetStackSize(epicsThreadStackMedium),
+                    (EPICSTHREADFUNC) ANC150InitC, this);
+}
+
+/** Body of the startup thread: makes the "ver" handshake, retrying with the
+  * probe backoff until the controller answers, then initializes the axes and
+  * marks the controller ready. */
+void ANC150Controller::initThread()
+{
+  double delay = ANC150_PROBE_MIN;
+  int retries;
+
+  while (!handshake()) {
+    if (shuttingDown_)
+      return;
+    epicsThreadSleep(delay);
+    delay = (2 * delay < ANC150_PROBE_MAX) ? 2 * delay : ANC150_PROBE_MAX;
+  }
+  initAxes(false);
+
+  epicsMutexLock(ioLock_);
+  probing_ = false;
+  link_ = ANC150LinkConnected;
+  linkFailures_ = 0;
+  retries = stats_.retries;
+  epicsMutexUnlock(ioLock_);
+
+  lock();
+  ready_ = true;
+  timeToReady_ = epicsTime::getCurrent() - createTime_;
+  unlock();
+  asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+            "ANC150Controller::initThread: %s ready in %f sec, %d handshake retries\n",
+            portName, timeToReady_, retries);
+  wakeupPoller();
+}
+
+/** Sends the login of the model, if any, then "ver" and stores the firmware version.
+  * May be called without the controller lock held.
+  * \return true if the controller answered. */
+bool ANC150Controller::handshake()
+{
+  char inputBuff[ANC150_BUFFER_SIZE];
+  size_t nActual, nRead;
+  int eomReason;
+  asynStatus status;
+
+  pasynOctetSyncIO->flush(pasynUserController_);
+  if (pProtocol_->login) {
+    /* The reply to the authorization code is not a command frame; it is only waited for. */
+    epicsMutexLock(ioLock_);
+    pasynOctetSyncIO->writeRead(pasynUserController_, pProtocol_->login, strlen(pProtocol_->login),
+                                inputBuff, sizeof(inputBuff), rtt_[ANC150TimeoutLong].maxTimeout,
+                                &nActual, &nRead, &eomReason);
+    pasynOctetSyncIO->flush(pasynUserController_);
+    epicsMutexUnlock(ioLock_);
+  }
+  status = sendAndReceive("ver", inputBuff, sizeof(inputBuff));
+  if (status == asynSuccess &&
+      strncmp(inputBuff, pProtocol_->versionPrefix, strlen(pProtocol_->versionPrefix)) == 0) {
+    epicsMutexLock(ioLock_);
+    if (strlen(inputBuff) > pProtocol_->firmwareOffset)
+      strncpy(firmwareVersion_, &inputBuff[pProtocol_->firmwareOffset], sizeof(firmwareVersion_) - 1);
+    epicsMutexUnlock(ioLock_);
+    return(true);
+  }
+  epicsMutexLock(ioLock_);
+  if (stats_.retries++ == 0)
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "ANC150Controller::handshake: no response to \"ver\" from %s controller on %s; retrying\n",
+              pProtocol_->model, ANC150PortName_);
+  epicsMutexUnlock(ioLock_);
+  return(false);
+}
+
+/** Initializes every axis in one burst.  At startup the frequency is read and
+  * step mode set; after a reconnection the cached frequency and mode are
+  * written back, since the controller may have been power cycled, and the
+  * frequency read to confirm them.
+  * Called without the controller lock held.
+  * \param[in] restore Restore the cached state rather than read it. */
+void ANC150Controller::initAxes(bool restore)
+{
+  ANC150Command cmds[3 * ANC150_MAX_AXES];
+  ANC150AxisState state[ANC150_MAX_AXES];
+  ANC150Axis *pAxis;
+  int axis, i, nCmds = 0;
+  int perAxis = restore ? 3 : 2;
+
+  lock();
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    state[axis].generation = pAxis->cacheGeneration_;
+    state[axis].frequency = pAxis->frequency_;
+    state[axis].stepMode = restore ? pAxis->stepMode_ : true;
+    state[axis].command = nCmds;
+    if (restore)
+      sprintf(cmds[nCmds++].command, "setf %d %d", axis + 1, pAxis->frequency_);
+    sprintf(cmds[nCmds++].command, "setm %d %s", axis + 1, state[axis].stepMode ? "stp" : "gnd");
+    sprintf(cmds[nCmds++].command, "getf %d", axis + 1);
+  }
+  unlock();
+
+  sendCommands(cmds, nCmds);
+
+  lock();
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    /* The "getf" is the last command of the axis. */
+    state[axis].status = decodeFreq(&cmds[state[axis].command + perAxis - 1], &state[axis].frequency);
+    for (i=0; i<perAxis-1; i++) {
+      if (cmds[state[axis].command + i].status != asynSuccess)
+        state[axis].status = asynError;
+    }
+    pAxis->commitState(&state[axis]);
+  }
+  unlock();
+}
+
+/** Records whether a transaction was answered and moves the link state.
+  * Called with ioLock_ held.
+  * \param[in] answered The controller answered; errors in the reply still count as an answer. */
+void ANC150Controller::linkResult(bool answered)
+{
+  if (answered) {
+    linkFailures_ = 0;
+    if (link_ == ANC150LinkDegraded)
+      link_ = ANC150LinkConnected;
+    return;
+  }
+  linkFailures_++;
+  /* A failed probe only lengthens the backoff. */
+  if (probing_ || link_ == ANC150LinkDisconnected)
+    return;
+  if (linkFailures_ < ANC150_DISCONNECT_FAILURES) {
+    link_ = ANC150LinkDegraded;
+    return;
+  }
+  link_ = ANC150LinkDisconnected;
+  probeDelay_ = ANC150_PROBE_MIN;
+  nextProbe_ = epicsTime::getCurrent() + probeDelay_;
+  ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_ERROR,
+                 "ANC150Controller::linkResult: no reply to %d transactions, link down\n", linkFailures_);
+}
+
+ANC150LinkState ANC150Controller::linkState()
+{
+  ANC150LinkState link;
+
+  epicsMutexLock(ioLock_);
+  link = link_;
+  epicsMutexUnlock(ioLock_);
+  return(link);
+}
+
+/** Probes a down link with the "ver" handshake once the backoff has expired;
+  * when the controller answers the axes are restored and the link is up again.
+  * Called by poll() without the controller lock held. */
+void ANC150Controller::reconnect(const epicsTime &now)
+{
+  bool answered;
+
+  epicsMutexLock(ioLock_);
+  if (link_ != ANC150LinkDisconnected || probing_ || now < nextProbe_) {
+    epicsMutexUnlock(ioLock_);
+    return;
+  }
+  probing_ = true;
+  epicsMutexUnlock(ioLock_);
+
+  answered = handshake();
+  if (answered)
+    initAxes(true);
+
+  epicsMutexLock(ioLock_);
+  probing_ = false;
+  if (answered) {
+    link_ = ANC150LinkConnected;
+    linkFailures_ = 0;
+    probeDelay_ = ANC150_PROBE_MIN;
+    stats_.reconnects++;
+    ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_ERROR,
+                   "ANC150Controller::reconnect: link restored, firmware %s\n", firmwareVersion_);
+  }
+  else {
+    probeDelay_ = (2 * probeDelay_ < ANC150_PROBE_MAX) ? 2 * probeDelay_ : ANC150_PROBE_MAX;
+    nextProbe_ = epicsTime::getCurrent() + probeDelay_;
+  }
+  epicsMutexUnlock(ioLock_);
+}
+
+/** Waits for all ANC150 controllers to be ready and prints their startup times.
+  * \param[in] timeout The longest time to wait (sec).
+  * \return The number of controllers that are not ready. */
+int ANC150Controller::startupSummary(double timeout)
+{
+  ANC150Controller *pC;
+  ANC150Stats stats;
+  epicsTime start = epicsTime::getCurrent();
+  int notReady;
+
+  do {
+    notReady = 0;
+    for (pC = pFirstController; pC; pC = pC->pNextController_) {
+      pC->lock();
+      if (!pC->ready_) notReady++;
+      pC->unlock();
+    }
+    if (notReady == 0) break;
+    epicsThreadSleep(0.1);
+  } while (epicsTime::getCurrent() - start < timeout);
+
+  printf("ANC150 startup summary:\n");
+  printf("  %-20s %-20s %-12s %14s %8s  %s\n", "port", "serial port", "state", "ready after(s)", "retries",
+         "firmware");
+  for (pC = pFirstController; pC; pC = pC->pNextController_) {
+    pC->readStats(&stats);
+    pC->lock();
+    if (pC->ready_)
+      printf("  %-20s %-20s %-12s %14.3f %8d  %s\n", pC->portName, pC->ANC150PortName_, linkNames[pC->linkState()],
+             pC->timeToReady_, stats.retries, pC->firmwareVersion_);
+    else
+      printf("  %-20s %-20s %-12s %14s %8d\n", pC->portName, pC->ANC150PortName_, "waiting", "-",
+             stats.retries);
+    pC->unlock();
+  }
+  return(notReady);
+}
+
+
+/** Validates the arguments of a configuration command and creates the controller. */
+static int createController(const char *functionName, const ANC150Protocol *pProtocol,
+                            const char *portName, const char *controllerPortName, int numAxes,
+                            int movingPollPeriod, int idlePollPeriod, int verifyPollPeriod,
+                            int publishPeriod)
+{
+  double verifyPeriod = (verifyPollPeriod > 0) ? verifyPollPeriod/1000. : ANC150_VERIFY_PERIOD;
+
+  if ((numAxes < 1) || (numAxes > pProtocol->maxAxes)) {
+    printf("%s: numAxes must in range 1 to %d\n", functionName, pProtocol->maxAxes);
+    return(asynError);
+  }
+  new ANC150Controller(portName, controllerPortName, numAxes, movingPollPeriod/1000., idlePollPeriod/1000.,
+                       verifyPeriod, (publishPeriod > 0) ? publishPeriod/1000. : 0.0, pProtocol);
+  return(asynSuccess);
+}
+
+/** Creates a new ANC150Controller object.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] ANC150PortName    The name of the drvAsynSerialPort that was created previously to connect to the ANC150 controller
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] movingPollPeriod  The time in ms between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time in ms between polls when no axis is moving
+  * \param[in] verifyPollPeriod  The time in ms between re-reads of cached axis state; 0 selects the default
+  * \param[in] publishPeriod     The time in ms between position updates of moving axes; 0 for none
+  */
+extern "C" int ANC150CreateController(const char *portName, const char *ANC150PortName, int numAxes,
+                                      int movingPollPeriod, int idlePollPeriod, int verifyPollPeriod,
+                                      int publishPeriod)
+{
+  return(createController("ANC150CreateController", &ANC150ProtocolANC150, portName, ANC150PortName,
+                          numAxes, movingPollPeriod, idlePollPeriod, verifyPollPeriod, publishPeriod));
+}
+
+/** Creates a new ANC150Controller object for an attocube ANC300, reached over TCP.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] ANC300PortName    The name of the drvAsynIPPort that was created previously to connect to the ANC300 controller
+  * \param[in] numAxes           The number of axes (modules) that this controller supports
+  * \param[in] movingPollPeriod  The time in ms between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time in ms between polls when no axis is moving
+  * \param[in] verifyPollPeriod  The time in ms between re-reads of cached axis state; 0 selects the default
+  * \param[in] publishPeriod     The time in ms between position updates of moving axes; 0 for none
+  */
+extern "C" int ANC300CreateController(const char *portName, const char *ANC300PortName, int numAxes,
+                                      int movingPollPeriod, int idlePollPeriod, int verifyPollPeriod,
+                                      int publishPeriod)
+{
+  return(createController("ANC300CreateController", &ANC150ProtocolANC300, portName, ANC300PortName,
+                          numAxes, movingPollPeriod, idlePollPeriod, verifyPollPeriod, publishPeriod));
+}
+
+/** Reports on status of the driver
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * If details > 0 then information is printed about each axis.
+  * After printing controller-specific information it calls asynMotorController::report()
+  */
+void ANC150Controller::report(FILE *fp, int level)
+{
+  ANC150Stats stats;
+
+  /* The transport counters are updated with ioLock_ held; report a snapshot. */
+  readStats(&stats);
+  fprintf(fp, "%s motor driver %s, firmware version: %s\n", pProtocol_->model, this->portName, firmwareVersion_);
+  if (level) {
+    int cls;
+
+    fprintf(fp, "    model: attocube %s\n", pProtocol_->model);
+    fprintf(fp, "    numAxes=%d, moving poll period=%f, idle poll period=%f, verify poll period=%f\n",
+      numAxes_, movingPollPeriod_, idlePollPeriod_, verifyPollPeriod_);
+    fprintf(fp, "    position publish period=%f\n", publishPeriod_);
+    if (ready_)
+      fprintf(fp, "    ready %f sec after creation, link %s, reconnects=%d\n", timeToReady_,
+        linkNames[linkState()], stats.reconnects);
+    else
+      fprintf(fp, "    not ready; waiting for the \"ver\" handshake on %s\n", ANC150PortName_);
+    fprintf(fp, "    timeouts=%d, errors=%d, discarded frames=%d, handshake retries=%d\n",
+      stats.timeouts, stats.errors, stats.discards, stats.retries);
+    epicsMutexLock(ioLock_);
+    for (cls=0; cls<ANC150NumTimeoutClasses; cls++)
+      fprintf(fp, "    %s timeout=%f (%f-%f), round trip p%02.0f=%f, %d samples, %d expired\n",
+        cls == ANC150TimeoutShort ? "short" : "long", rtt_[cls].timeout, rtt_[cls].minTimeout,
+        rtt_[cls].maxTimeout, 100 * ANC150_RTT_PERCENTILE, rtt_[cls].percentile, rtt_[cls].count,
+        rtt_[cls].expired);
+    epicsMutexUnlock(ioLock_);
+    fprintf(fp, "    polls=%d, last poll time=%f, poll period=%f, jitter=%f, overruns=%d\n",
+      stats.polls, stats.pollTime, stats.pollPeriod, stats.pollJitter, stats.pollOverruns);
+    if (mailboxEvent_)
+      fprintf(fp, "    move mailbox: coalesced=%d, preempted by stop=%d\n",
+        stats.coalesced, stats.preempted);
+    if (pPollerPool_)
+      pPollerPool_->report(fp);
+    fprintf(fp, "    last group move start skew=%f\n", stats.groupSkew);
+  }
+  if (level > 1) {
+    int i, j;
+
+    fprintf(fp, "    latency histograms (ms):   <1   <2   <5  <10  <20  <50 <100 <200 <500  <1s  <2s  >2s\n");
+    for (i=0; i<ANC150NumCmdClasses; i++) {
+      fprintf(fp, "      %-5s n=%-7d mean=%8.3f max=%8.3f |", cmdClassNames[i], stats.count[i],
+        stats.count[i] ? 1000. * stats.latencySum[i] / stats.count[i] : 0.0,
+        1000. * stats.latencyMax[i]);
+      for (j=0; j<ANC150_HIST_BINS; j++)
+        fprintf(fp, " %4d", stats.histogram[i][j]);
+      fprintf(fp, "\n");
+    }
+  }
+
+  // Call the base class method
+  asynMotorController::report(fp, level);
+}
+
+/** Returns a pointer to an ANC150Axis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] pasynUser asynUser structure that encodes the axis index number. */
+ANC150Axis* ANC150Controller::getAxis(asynUser *pasynUser)
+{
+  return static_cast<ANC150Axis*>(asynMotorController::getAxis(pasynUser));
+}
+
+/** Returns a pointer to an ANC150Axis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] axisNo Axis index number. */
+ANC150Axis* ANC150Controller::getAxis(int axisNo)
+{
+  return static_cast<ANC150Axis*>(asynMotorController::getAxis(axisNo));
+}
+
+/** Moves several axes with a single burst of step commands.
+  * \param[in] nAxes The number of axes to move.
+  * \param[in] axes The axis index numbers.
+  * \param[in] positions The positions (steps), one per axis.
+  * \param[in] relative 0 for absolute positions, 1 for relative. */
+asynStatus ANC150Controller::groupMove(int nAxes, const int *axes, const double *positions, int relative)
+{
+  ANC150Axis *pAxis;
+  asynStatus status, moveStatus = asynSuccess;
+  int i;
+
+  for (i=0; i<nAxes; i++) {
+    if (!getAxis(axes[i])) {
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                "ANC150Controller::groupMove: invalid axis %d\n", axes[i]);
+      return asynError;
+    }
+  }
+
+  lock();
+  setDeferredMoves(true);
+  for (i=0; i<nAxes; i++) {
+    pAxis = getAxis(axes[i]);
+    /* An axis that cannot move (jogging, not ready, position source
+     * unreadable) keeps its Done; the others still move together. */
+    if (pAxis->move(positions[i], relative, 0., 0., 0.) != asynSuccess) {
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                "ANC150Controller::groupMove: axis %d cannot move\n", axes[i]);
+      moveStatus = asynError;
+      continue;
+    }
+    pAxis->setIntegerParam(motorStatusDone_, 0);
+  }
+  status = setDeferredMoves(false);
+  if (status == asynSuccess)
+    status = moveStatus;
+  for (i=0; i<nAxes; i++)
+    getAxis(axes[i])->callParamCallbacks();
+  callParamCallbacks();
+  unlock();
+  wakeupPoller();
+  return status;
+}
+
+/** Starts or ends a group of deferred moves.  Called with the controller lock held.
+  * While moves are deferred ANC150Axis::move() only records its steps; ending
+  * the group sends the step commands of all axes back to back in one burst and
+  * starts all the simulated trajectories from one timestamp; the "setf" of
+  * axes whose frequency changed precede them in the same burst.  The spread of the
+  * replies, which bounds the skew between the axis starts, is published as
+  * ANC150_GROUP_SKEW.
+  * \param[in] defer true to start collecting moves, false to send them. */
+asynStatus ANC150Controller::setDeferredMoves(bool defer)
+{
+  ANC150Command cmds[2 * ANC150_MAX_AXES];
+  ANC150Axis *pAxes[2 * ANC150_MAX_AXES];
+  ANC150Axis *pAxis;
+  epicsTime start;
+  double first = 0.0, last = 0.0;
+  asynStatus status = asynSuccess;
+  int nCmds, nStarted = 0, nFrequencies;
+  int i;
+
+  if (defer || !movesDeferred_) {
+    movesDeferred_ = defer;
+    return asynSuccess;
+  }
+  movesDeferred_ = false;
+
+  nCmds = formatDeferredMoves(cmds, pAxes, &nFrequencies);
+  if (nCmds == 0)
+    return asynSuccess;
+
+  start = epicsTime::getCurrent();
+  status = sendCommands(cmds, nCmds);
+
+  for (i=0; i<nFrequencies; i++)
+    pAxes[i]->frequencySent(&cmds[i]);
+  for (i=nFrequencies; i<nCmds; i++) {
+    pAxis = pAxes[i];
+    if (cmds[i].status == asynSuccess) {
+      pAxis->startTimer(pAxis->deferredSteps_, start);
+      if (nStarted == 0 || cmds[i].latency < first) first = cmds[i].latency;
+      if (nStarted == 0 || cmds[i].latency > last) last = cmds[i].latency;
+      nStarted++;
+    } else {
+      /* The axis did not start; report it done where it is. */
+      pAxis->targetPosition_ = pAxis->currentPosition_;
+      if (pAxis->approaching_)
+        pAxis->endApproach(true);
+    }
+  }
+  stats_.groupSkew = last - first;
+  setDoubleParam(ANC150GroupSkew_, stats_.groupSkew);
+  ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_FLOW,
+                 "ANC150Controller::setDeferredMoves: %d axes started, %d frequencies set, skew=%f\n",
+                 nCmds - nFrequencies, nFrequencies, stats_.groupSkew);
+  return(status);
+}
+
+/** Formats the commands of all deferred moves and marks the moves sent.
+  * The "setf" of axes whose frequency changed come first, then the step
+  * commands back to back.  Called with the controller lock held.
+  * \param[out] pCmds Room for 2 * ANC150_MAX_AXES commands.
+  * \param[out] pAxes The axis of each command.
+  * \param[out] pNFrequencies The number of "setf" commands.
+  * \return The number of commands. */
+int ANC150Controller::formatDeferredMoves(ANC150Command *pCmds, ANC150Axis **pAxes, int *pNFrequencies)
+{
+  ANC150Axis *pAxis;
+  int nCmds = 0;
+  int axis;
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis || !pAxis->deferredMove_ || !pAxis->deferredFrequency_) continue;
+    pAxes[nCmds] = pAxis;
+    sprintf(pCmds[nCmds++].command, "setf %d %d", axis + 1, pAxis->frequency_);
+  }
+  *pNFrequencies = nCmds;
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis || !pAxis->deferredMove_) continue;
+    pAxes[nCmds] = pAxis;
+    pAxis->formatStep(pAxis->deferredSteps_, pCmds[nCmds++].command);
+    pAxis->deferredMove_ = false;
+    pAxis->deferredFrequency_ = false;
+  }
+  return(nCmds);
+}
+
+/** Called when asyn clients call pasynInt32Array->read().
+  * Returns the latency histogram of a command class.
+  * \param[in] pasynUser asynUser structure that encodes the reason and address.
+  * \param[out] value Array of histogram bins.
+  * \param[in] nElements Number of elements in the value array.
+  * \param[out] nIn Number of elements returned. */
+asynStatus ANC150Controller::readInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements, size_t *nIn)
+{
+  int function = pasynUser->reason;
+  int cmdClass;
+  size_t i;
+
+  if      (function == ANC150QueryHist_) cmdClass = ANC150CmdQuery;
+  else if (function == ANC150SetHist_)   cmdClass = ANC150CmdSet;
+  else if (function == ANC150MoveHist_)  cmdClass = ANC150CmdMove;
+  else if (function == ANC150StopHist_)  cmdClass = ANC150CmdStop;
+  else return asynMotorController::readInt32Array(pasynUser, value, nElements, nIn);
+
+  *nIn = (nElements < ANC150_HIST_BINS) ? nElements : ANC150_HIST_BINS;
+  epicsMutexLock(ioLock_);
+  for (i=0; i<*nIn; i++)
+    value[i] = stats_.histogram[cmdClass][i];
+  epicsMutexUnlock(ioLock_);
+  return asynSuccess;
+}
+
+/** Adds a command's latency to the statistics.  Called with ioLock_ held.
+  * \param[in] pDef The command table entry of the command; NULL counts as a query.
+  * \param[in] latency The time from sending the command to receiving its reply (sec). */
+void ANC150Controller::recordLatency(const ANC150CommandDef *pDef, double latency)
+{
+  int cmdClass = pDef ? pDef->cmdClass : ANC150CmdQuery;
+  int bin;
+
+  for (bin=0; bin<ANC150_HIST_BINS - 1 && latency >= histEdges[bin]; bin++)
+    ;
+  stats_.histogram[cmdClass][bin]++;
+  stats_.count[cmdClass]++;
+  stats_.latencySum[cmdClass] += latency;
+  if (latency > stats_.latencyMax[cmdClass])
+    stats_.latencyMax[cmdClass] = latency;
+}
+
+/** Updates the poll timing statistics at the end of a poll.  Called with the controller lock held.
+  * \param[in] start The time at which the poll started. */
+void ANC150Controller::recordPoll(const epicsTime &start)
+{
+  double period;
+
+  stats_.polls++;
+  stats_.pollTime = epicsTime::getCurrent() - start;
+  if (stats_.pollTime > movingPollPeriod_)
+    stats_.pollOverruns++;
+  if (stats_.havePoll) {
+    period = start - stats_.lastPollStart;
+    /* Interarrival jitter estimator as in RFC 3550. */
+    stats_.pollJitter += (fabs(period - stats_.pollPeriod) - stats_.pollJitter) / 16.0;
+    stats_.pollPeriod = period;
+  }
+  stats_.lastPollStart = start;
+  stats_.havePoll = true;
+}
+
+/** Copies the statistics to the parameter library.  Called with the controller lock held;
+  * the callbacks are made by the poll's callback sweep. */
+void ANC150Controller::publishStats()
+{
+  int i, commands = 0;
+
+  for (i=0; i<ANC150NumCmdClasses; i++)
+    commands += stats_.count[i];
+  setIntegerParam(ANC150Commands_,     commands);
+  setIntegerParam(ANC150Timeouts_,     stats_.timeouts);
+  setIntegerParam(ANC150Errors_,       stats_.errors);
+  setIntegerParam(ANC150Discards_,     stats_.discards);
+  setIntegerParam(ANC150Retries_,      stats_.retries);
+  setIntegerParam(ANC150Reconnects_,   stats_.reconnects);
+  setIntegerParam(ANC150Coalesced_,    stats_.coalesced);
+  setIntegerParam(ANC150Preempted_,    stats_.preempted);
+  setIntegerParam(ANC150LinkState_,    linkState());
+  epicsMutexLock(ioLock_);
+  setDoubleParam(ANC150IoTimeout_,     rtt_[ANC150TimeoutShort].timeout);
+  epicsMutexUnlock(ioLock_);
+  setIntegerParam(ANC150PollOverruns_, stats_.pollOverruns);
+  setDoubleParam(ANC150PollTime_,      stats_.pollTime);
+  setDoubleParam(ANC150PollPeriod_,    stats_.pollPeriod);
+  setDoubleParam(ANC150PollJitter_,    stats_.pollJitter);
+}
+
+static void ANC150PollerC(void *pPvt)
+{
+  ANC150Controller *pC = (ANC150Controller *) pPvt;
+  pC->pollerThread();
+}
+
+/** Starts the poller; replaces the base class poller.  The controller joins
+  * the poller pool if ANC150CreatePollerPool() was called, and otherwise starts
+  * its own thread.
+  * \param[in] movingPollPeriod The time between polls when any axis is moving.
+  * \param[in] idlePollPeriod The time between polls when no axis is moving; 0 for no idle polling.
+  * \param[in] forcedFastPolls The number of polls at movingPollPeriod after the poller is woken. */
+asynStatus ANC150Controller::startPoller(double movingPollPeriod, double idlePollPeriod, int forcedFastPolls)
+{
+  char name[64];
+
+  movingPollPeriod_ = movingPollPeriod;
+  idlePollPeriod_ = idlePollPeriod;
+  forcedFastPolls_ = forcedFastPolls;
+  nextStatus_ = nextPublish_ = epicsTime::getCurrent();
+  if (ANC150PollerPool::defaultPool) {
+    pPollerPool_ = ANC150PollerPool::defaultPool;
+    pPollerEntry_ = pPollerPool_->add(this);
+    return asynSuccess;
+  }
+  /* One thread per controller, named after its port. */
+  epicsSnprintf(name, sizeof(name), "ANC150:%s", portName);
+  epicsThreadCreate(name, epicsThreadPriorityMedium,
+                    epicsThreadGetStackSize(epicsThreadStackMedium),
+                    (EPICSTHREADFUNC) ANC150PollerC, this);
+  return asynSuccess;
+}
+
+/** Forces an immediate poll, from the pool if the controller is in one. */
+asynStatus ANC150Controller::wakeupPoller()
+{
+  if (!pPollerPool_)
+    return asynMotorController::wakeupPoller();
+  pPollerPool_->wakeup(pPollerEntry_);
+  return asynSuccess;
+}
+
+/** Stops or restarts the status polls of the poller, so that the benchmark
+  * can call poll() without another poll running.  Pausing waits for a poller
+  * step in progress, which may have released the lock for its I/O.
+  * Called without the controller lock held.
+  * \param[in] pause true to stop the polls, false to restart them. */
+void ANC150Controller::pausePoller(bool pause)
+{
+  lock();
+  pollerPaused_ = pause;
+  while (pause && pollerStepping_) {
+    unlock();
+    epicsThreadSleep(0.001);
+    lock();
+  }
+  unlock();
+  if (!pause)
+    wakeupPoller();
+}
+
+/** Makes the next poll re-read the frequency and mode of the first nAxes
+  * axes.  Called with the controller lock held. */
+void ANC150Controller::invalidateCache(int nAxes)
+{
+  ANC150Axis *pAxis;
+  int axis;
+
+  for (axis=0; axis<nAxes && axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (pAxis)
+      pAxis->cacheValid_ = false;
+  }
+}
+
+/** Copies the statistics, the transport counters with ioLock_ held.
+  * May be called with or without the controller lock held. */
+void ANC150Controller::readStats(ANC150Stats *pStats)
+{
+  lock();
+  epicsMutexLock(ioLock_);
+  *pStats = stats_;
+  epicsMutexUnlock(ioLock_);
+  unlock();
+}
+
+/** Returns the longest timeout of short transactions (sec). */
+double ANC150Controller::maxTimeout()
+{
+  double timeout;
+
+  epicsMutexLock(ioLock_);
+  timeout = rtt_[ANC150TimeoutShort].maxTimeout;
+  epicsMutexUnlock(ioLock_);
+  return(timeout);
+}
+
+/** Body of the controller's own poller thread. */
+void ANC150Controller::pollerThread()
+{
+  epicsTime deadline;
+  epicsEventStatus status;
+  bool haveDeadline, woken = false;
+
+  while (pollerStep(woken, &deadline, &haveDeadline)) {
+    if (haveDeadline)
+      status = epicsEventWaitWithTimeout(pollEventId_, deadline - epicsTime::getCurrent());
+    else
+      status = epicsEventWait(pollEventId_);
+    woken = (status == epicsEventWaitOK);
+  }
+}
+
+/** Makes one status poll or position publish and schedules the next.
+  * Status polls are scheduled on absolute deadlines, each one period after the
+  * previous deadline rather than after the end of the previous poll, so the
+  * poll rate does not drift by the poll time.  The poller also wakes at the
+  * earliest time an axis is predicted to finish its move (or a jog to reach a
+  * soft limit), so motorStatusDone is set as soon as the move is complete
+  * instead of up to a whole moving poll period later.  wakeupPoller() forces
+  * an immediate poll followed by forcedFastPolls_ polls at movingPollPeriod_.
+  * Between status polls, the positions of moving axes are published every
+  * publishPeriod_ without serial I/O.  Called by the controller's own poller
+  * thread or by a worker of the poller pool, never by two threads at once.
+  * \param[in] woken wakeupPoller() was called since the last step.
+  * \param[out] pDeadline The time of the next step.
+  * \param[out] pHaveDeadline false if the next step waits for wakeupPoller().
+  * \return false if the controller is shutting down. */
+bool ANC150Controller::pollerStep(bool woken, epicsTime *pDeadline, bool *pHaveDeadline)
+{
+  ANC150Axis *pAxis;
+  epicsTime now, deadline, stopTime;
+  double period;
+  bool moving, haveDeadline;
+  int axis;
+
+  lock();
+  if (shuttingDown_) {
+    unlock();
+    return false;
+  }
+  if (pollerPaused_) {
+    /* No deadline: pausePoller(false) wakes the poller. */
+    unlock();
+    *pHaveDeadline = false;
+    return true;
+  }
+  pollerStepping_ = true;
+  if (woken) {
+    fastPolls_ = forcedFastPolls_;
+    nextStatus_ = nextPublish_ = epicsTime::getCurrent();
+    statusPoll_ = true;
+  }
+  if (statusPoll_) {
+    anyMoving_ = false;
+    poll();
+    for (axis=0; axis<numAxes_; axis++) {
+      pAxis = getAxis(axis);
+      if (!pAxis) continue;
+      pAxis->poll(&moving);
+      if (moving) anyMoving_ = true;
+    }
+    if (fastPolls_ > 0)
+      fastPolls_--;
+  } else {
+    publishPositions();
+  }
+
+  /* Next status deadline; if polls have fallen behind, skip the missed ones. */
+  period = (anyMoving_ || fastPolls_ > 0) ? movingPollPeriod_ : idlePollPeriod_;
+  now = epicsTime::getCurrent();
+  haveDeadline = (period > 0.0);
+  if (haveDeadline) {
+    if (nextStatus_ <= now)
+      nextStatus_ += period;
+    if (nextStatus_ <= now)
+      nextStatus_ = now + period;
+    deadline = nextStatus_;
+  }
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (pAxis && pAxis->predictStop(&stopTime) && stopTime > now &&
+        (!haveDeadline || stopTime < deadline)) {
+      deadline = stopTime;
+      haveDeadline = true;
+    }
+  }
+  statusPoll_ = true;
+  if (anyMoving_ && publishPeriod_ > 0.0) {
+    if (nextPublish_ <= now)
+      nextPublish_ += publishPeriod_;
+    if (nextPublish_ <= now)
+      nextPublish_ = now + publishPeriod_;
+    if (!haveDeadline || nextPublish_ < deadline) {
+      deadline = nextPublish_;
+      haveDeadline = true;
+      statusPoll_ = false;
+    }
+  }
+  pollerStepping_ = false;
+  unlock();
+
+  *pDeadline = deadline;
+  *pHaveDeadline = haveDeadline;
+  return true;
+}
+
+/** Publishes the simulated positions of the moving axes.  Called with the
+  * controller lock held; makes no serial I/O. */
+void ANC150Controller::publishPositions()
+{
+  ANC150Axis *pAxis;
+  epicsTime now = epicsTime::getCurrent();
+  int axis;
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (pAxis && pAxis->publishPosition(now))
+      pAxis->callParamCallbacks();
+  }
+}
+
+/** Polls all axes of the controller in one pass.
+  * The base class poller calls this with the controller lock held.  Axes whose
+  * cached state must be re-read are queried with the controller lock released,
+  * so that parameter writes are not held up by serial transactions; the results
+  * are then committed and every axis has its parameters updated before a single
+  * sweep of callbacks is made for all axes.  ANC150Axis::poll() then only
+  * reports the moving state computed here. */
+asynStatus ANC150Controller::poll()
+{
+  ANC150AxisState state[ANC150_MAX_AXES];
+  ANC150Command cmds[4 * ANC150_MAX_AXES];
+  ANC150Command approachCmds[ANC150_MAX_AXES];
+  ANC150Axis *pAxis;
+  epicsTime now = epicsTime::getCurrent();
+  epicsTime start;
+  int nCmds = 0, nFeedback = 0, nApproach = 0;
+  int axis;
+  bool offline;
+
+  if (!ready_) {
+    /* The startup thread owns the serial port; report the axes as not communicating. */
+    for (axis=0; axis<numAxes_; axis++) {
+      pAxis = getAxis(axis);
+      if (!pAxis) continue;
+      pAxis->updateStatus();
+      pAxis->callParamCallbacks();
+    }
+    return asynSuccess;
+  }
+
+  /* A down link is only probed; the axes are not queried until it is back. */
+  if (linkState() == ANC150LinkDisconnected) {
+    unlock();
+    reconnect(now);
+    lock();
+  }
+  offline = (linkState() == ANC150LinkDisconnected);
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (pAxis && offline) {
+      pAxis->commError_ = true;
+      pAxis->cacheValid_ = false;
+    }
+    /* Jogs that have reached a soft limit are stopped in the same burst. */
+    state[axis].jogCommand = nCmds;
+    state[axis].nJogCommands = 0;
+    if (!offline && pAxis && pAxis->jogging_ && pAxis->pastLimit(pAxis->simPosition(now), pAxis->jogDirection_)) {
+      state[axis].nJogCommands = pAxis->formatJogStop(&cmds[nCmds]);
+      nCmds += state[axis].nJogCommands;
+    }
+    state[axis].feedback = pAxis && pAxis->pasynUserFeedback_;
+    if (state[axis].feedback)
+      nFeedback++;
+    state[axis].approachCommand = -1;
+    state[axis].verify = !offline && pAxis && (!pAxis->cacheValid_ || pAxis->nextVerify_ <= now);
+    if (!state[axis].verify) continue;
+    state[axis].generation = pAxis->cacheGeneration_;
+    state[axis].frequency = pAxis->frequency_;
+    state[axis].command = nCmds;
+    sprintf(cmds[nCmds++].command, "getf %d", axis + 1);
+    sprintf(cmds[nCmds++].command, "getm %d", axis + 1);
+  }
+
+  if (nCmds > 0 || nFeedback > 0) {
+    /* All queries go out as one pipelined burst.  External position sources
+     * are read in the same unlocked phase. */
+    unlock();
+    if (nCmds > 0)
+      sendCommands(cmds, nCmds);
+    for (axis=0; axis<numAxes_; axis++) {
+      if (state[axis].feedback)
+        state[axis].feedbackStatus = getAxis(axis)->readFeedback(&state[axis].feedbackRaw);
+    }
+    lock();
+  }
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    if (state[axis].nJogCommands > 0 && pAxis->jogging_) {
+      ANC150LogPrint(pasynUserSelf, portName, axis, ASYN_TRACE_FLOW,
+                     "ANC150Controller::poll: jog stopped at soft limit\n");
+      pAxis->endJog(now + cmds[state[axis].jogCommand].latency,
+                    &cmds[state[axis].jogCommand], state[axis].nJogCommands);
+    }
+    if (state[axis].verify) {
+      state[axis].status = decodeFreq(&cmds[state[axis].command], &state[axis].frequency);
+      state[axis].stepMode = decodeMode(&cmds[state[axis].command + 1]);
+      pAxis->commitState(&state[axis]);
+    }
+    if (state[axis].feedback) {
+      pAxis->commitFeedback(state[axis].feedbackStatus, state[axis].feedbackRaw);
+      if (!offline && pAxis->approachDue(now) && pAxis->approachStep(approachCmds[nApproach].command)) {
+        state[axis].approachCommand = nApproach++;
+        state[axis].approachGeneration = pAxis->approachGeneration_;
+      }
+    }
+  }
+
+  if (nApproach > 0) {
+    /* Approach corrections of all axes go out as a second burst. */
+    unlock();
+    start = epicsTime::getCurrent();
+    sendCommands(approachCmds, nApproach);
+    lock();
+  }
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    if (state[axis].approachCommand >= 0)
+      pAxis->approachSent(&approachCmds[state[axis].approachCommand], start, state[axis].approachGeneration);
+    pAxis->updateStatus();
+  }
+
+  recordPoll(now);
+  publishStats();
+  saveStepModel(now);
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    pAxis->callParamCallbacks();
+  }
+  return asynSuccess;
+}
+
+/** Sends a command to the controller and discards the reply.
+  * The ANC150 echoes every command and terminates every reply with a "> " prompt,
+  * so this is a write/read transaction too.
+  * \param[in] outputBuff The command string, without the output EOS. */
+asynStatus ANC150Controller::sendOnly(const char *outputBuff)
+{
+  char inputBuff[ANC150_BUFFER_SIZE];
+  size_t nRequested = strlen(outputBuff);
+  size_t nActual = 0, nRead;
+  asynStatus status;
+  int eomReason;
+  epicsTime start, readStart;
+  double latency;
+  const ANC150CommandDef *pDef = ANC150FindCommand(outputBuff);
+  ANC150Rtt *pRtt = &rtt_[pDef ? pDef->timeoutClass : ANC150TimeoutShort];
+
+  epicsMutexLock(ioLock_);
+  if (link_ == ANC150LinkDisconnected && !probing_) {
+    epicsMutexUnlock(ioLock_);
+    return(asynDisconnected);
+  }
+  /* As in sendCommands(), the adaptive timeout is for the reply only; the
+   * write gets the maximum. */
+  pasynOctetSyncIO->flush(pasynUserController_);
+  start = epicsTime::getCurrent();
+  status = pasynOctetSyncIO->write(pasynUserController_, outputBuff, nRequested, pRtt->maxTimeout, &nActual);
+  if (status == asynSuccess && nActual != nRequested)
+    status = asynError;
+  if (status == asynSuccess) {
+    readStart = epicsTime::getCurrent();
+    status = pasynOctetSyncIO->read(pasynUserController_, inputBuff, sizeof(inputBuff),
+                                    pRtt->timeout, &nRead, &eomReason);
+  }
+  if (status == asynSuccess) {
+    latency = epicsTime::getCurrent() - start;
+    recordLatency(pDef, latency);
+    ANC150RttSample(pRtt, epicsTime::getCurrent() - readStart);
+  }
+  else if (status == asynTimeout) {
+    stats_.timeouts++;
+    ANC150RttExpired(pRtt);
+  }
+  else
+    stats_.errors++;
+  linkResult(status == asynSuccess);
+  epicsMutexUnlock(ioLock_);
+
+  if (status != asynSuccess) {
+    ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_ERROR,
+                   "ANC150Controller::sendOnly: error sending command %s, sent=%d, status=%d\n",
+                   outputBuff, (int) nActual, status);
+  }
+
+  return(status);
+}
+
+/** Sends a command to the controller and returns the reply line.
+  * \param[in] outputBuff The command string, without the output EOS.
+  * \param[out] inputBuff The reply line.
+  * \param[in] inputSize The size of inputBuff. */
+asynStatus ANC150Controller::sendAndReceive(const char *outputBuff, char *inputBuff, size_t inputSize)
+{
+  ANC150Command cmd;
+  asynStatus status;
+
+  strncpy(cmd.command, outputBuff, sizeof(cmd.command) - 1);
+  cmd.command[sizeof(cmd.command) - 1] = 0;
+  status = sendCommands(&cmd, 1);
+  strncpy(inputBuff, cmd.result.text, inputSize - 1);
+  inputBuff[inputSize - 1] = 0;
+  return(status);
+}
+
+/** Sends a list of commands to the controller as pipelined bursts.
+  * Up to ANC150_MAX_PIPELINE commands are written with a single write; the
+  * replies are then read one frame per "> " prompt and matched to their
+  * commands by the echoed command line, so the whole burst costs one round trip.
+  * Frames that echo none of the outstanding commands (e.g. the trailing error
+  * message after "Axis not in computer control mode") are discarded.  Frames
+  * are split and decoded in the receive buffer by ANC150ParseFrame() and
+  * ANC150ParseReply(); nothing is copied.
+  * May be called without the controller lock held.
+  * \param[in,out] pCmds The commands; pDef, result and status are filled in for each.
+  * \param[in] nCmds The number of commands.
+  * \return asynSuccess if every command was answered. */
+asynStatus ANC150Controller::sendCommands(ANC150Command *pCmds, int nCmds)
+{
+  char outputBuff[ANC150_MAX_PIPELINE * (ANC150_COMMAND_SIZE + ANC150_EOS_SIZE)];
+  char frame[ANC150_BUFFER_SIZE];
+  ANC150Frame view;
+  size_t len, nWrite, nRead;
+  int eomReason, n;
+  int first, last, next, i, nFrames;
+  asynStatus status = asynSuccess;
+  asynStatus ioStatus = asynSuccess;
+  epicsTime start, readStart;
+  ANC150Rtt *pRtt;
+  static const char *functionName = "ANC150Controller::sendCommands";
+
+  for (i=0; i<nCmds; i++) {
+    pCmds[i].pDef = ANC150FindCommand(pCmds[i].command);
+    pCmds[i].result.code = ANC150ResultBadReply;
+    pCmds[i].status = asynError;
+    pCmds[i].latency = 0.0;
+  }
+
+  epicsMutexLock(ioLock_);
+  if (link_ == ANC150LinkDisconnected && !probing_) {
+    epicsMutexUnlock(ioLock_);
+    return(asynDisconnected);
+  }
+  for (first=0; first<nCmds && ioStatus == asynSuccess; first=last) {
+    last = first + ANC150_MAX_PIPELINE;
+    if (last > nCmds)
+      last = nCmds;
+
+    /* The port appends the output EOS after the last command of the burst.
+     * The burst waits with the timeout of its longest command class. */
+    pRtt = &rtt_[ANC150TimeoutShort];
+    len = 0;
+    for (i=first; i<last; i++) {
+      if (pCmds[i].pDef && pCmds[i].pDef->timeoutClass != ANC150TimeoutShort)
+        pRtt = &rtt_[pCmds[i].pDef->timeoutClass];
+      n = epicsSnprintf(&outputBuff[len], sizeof(outputBuff) - len, "%s%s", pCmds[i].command,
+                        (i < last - 1) ? pProtocol_->outEos : "");
+      if (n < 0 || (size_t) n >= sizeof(outputBuff) - len)
+        break;
+      len += n;
+    }
+    if (i < last) {
+      /* Only an output EOS longer than ANC150_EOS_SIZE can get here. */
+      stats_.errors++;
+      status = ioStatus = asynError;
+      ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_ERROR,
+                     "%s: burst from %s does not fit the output buffer\n", functionName, pCmds[first].command);
+      break;
+    }
+
+    pasynOctetSyncIO->flush(pasynUserController_);
+    start = epicsTime::getCurrent();
+    ioStatus = pasynOctetSyncIO->write(pasynUserController_, outputBuff, len, pRtt->maxTimeout, &nWrite);
+    if (ioStatus == asynSuccess && nWrite != len)
+      ioStatus = asynError;
+
+    next = first;
+    for (nFrames=0; ioStatus == asynSuccess && next < last && nFrames < 2 * (last - first); nFrames++) {
+      readStart = epicsTime::getCurrent();
+      ioStatus = pasynOctetSyncIO->read(pasynUserController_, frame, sizeof(frame),
+                                        pRtt->timeout, &nRead, &eomReason);
+      if (ioStatus != asynSuccess)
+        break;
+      /* One sample per burst: the later frames are already on their way
+       * when the first arrives, so their reads are not round trips. */
+      if (nFrames == 0)
+        ANC150RttSample(pRtt, epicsTime::getCurrent() - readStart);
+      if (ANC150ParseFrame(frame, nRead, &view) == 0) {
+        stats_.discards++;
+        continue;
+      }
+      for (i=next; i<last && !ANC150ViewEquals(&view.echo, pCmds[i].command); i++)
+        ;
+      if (i == last) {
+        stats_.discards++;
+        continue;
+      }
+      pCmds[i].latency = epicsTime::getCurrent() - start;
+      recordLatency(pCmds[i].pDef, pCmds[i].latency);
+      ANC150ParseReply(pCmds[i].pDef, &view, &pCmds[i].result);
+      pCmds[i].status = asynSuccess;
+      next = i + 1;
+    }
+
+    if (next < last) {
+      if (ioStatus == asynTimeout) {
+        stats_.timeouts++;
+        ANC150RttExpired(pRtt);
+      }
+      else
+        stats_.errors++;
+      status = (ioStatus != asynSuccess) ? ioStatus : asynError;
+      ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_ERROR,
+                     "%s: %d of %d replies received, first command=%s status=%d, error=%s\n",
+                     functionName, next - first, last - first, pCmds[first].command, ioStatus,
+                     pasynUserController_->errorMessage);
+    }
+    linkResult(nFrames > 0);
+  }
+  epicsMutexUnlock(ioLock_);
+
+  return(status);
+}
+
+/** Decodes the reply to "getf".
+  * \param[in] pCmd The command and its reply.
+  * \param[out] frequency The step frequency; unchanged if it could not be read. */
+static asynStatus decodeFreq(const ANC150Command *pCmd, int *frequency)
+{
+  if (pCmd->status != asynSuccess)
+    return(pCmd->status);
+  switch (pCmd->result.code) {
+  case ANC150ResultOK:
+    *frequency = pCmd->result.value;
+    return(asynSuccess);
+  case ANC150ResultNotInControl:
+    return(asynSuccess);
+  default:
+    return(asynError);
+  }
+}
+
+/** Decodes the reply to "getm".
+  * \param[in] pCmd The command and its reply.
+  * \return true if the axis is in step mode, false if it is grounded. */
+static bool decodeMode(const ANC150Command *pCmd)
+{
+  if (pCmd->result.code == ANC150ResultOK)
+    return(pCmd->result.value != 0);
+  else if (pCmd->result.code == ANC150ResultNotInControl)
+    return(false);
+  return(true);
+}
+
+/** Reads the step frequency of an axis with "getf".
+  * May be called without the controller lock held.
+  * \param[in] axis The axis index number.
+  * \param[out] frequency The step frequency; unchanged if it could not be read. */
+asynStatus ANC150Controller::getFreq(int axis, int *frequency)
+{
+  ANC150Command cmd;
+
+  sprintf(cmd.command, "getf %d", axis + 1);
+  sendCommands(&cmd, 1);
+  return(decodeFreq(&cmd, frequency));
+}
+
+/** Reads the mode of an axis with "getm".
+  * May be called without the controller lock held.
+  * \param[in] axis The axis index number.
+  * \return true if the axis is in step mode, false if it is grounded. */
+bool ANC150Controller::stpMode(int axis)
+{
+  ANC150Command cmd;
+
+  sprintf(cmd.command, "getm %d", axis + 1);
+  sendCommands(&cmd, 1);
+  return(decodeMode(&cmd));
+}
+
+
+// These are the ANC150Axis methods
+
+/** Creates a new ANC150Axis object.
+  * \param[in] pC Pointer to the ANC150Controller to which this axis belongs.
+  * \param[in] axisNo Index number of this axis, range 0 to pC->numAxes_-1.
+  *
+  * Initializes register numbers, etc.
+  */
+ANC150Axis::ANC150Axis(ANC150Controller *pC, int axisNo)
+  : asynMotorAxis(pC, axisNo),
+    pC_(pC),
+    targetPosition_(0.0), currentPosition_(0.0),
+    highLimit_(0.0), lowLimit_(0.0),
+    moving_(false), moveInterval_(0.0), frequency_(0),
+    stepMode_(true), commError_(true), cacheValid_(false), cacheGeneration_(0),
+    deferredMove_(false), deferredSteps_(0), deferredFrequency_(false),
+    jogging_(false), jogDirection_(0), jogStartPosition_(0.0), restoreFrequency_(0),
+    pasynUserFeedback_(NULL), feedbackScale_(1.0), feedbackOffset_(0.0), tolerance_(0.0),
+    maxIterations_(0), settleTime_(0.0), measuredPosition_(0.0), feedbackError_(false),
+    approaching_(false), approachFailed_(false), approachTarget_(0.0), iterations_(0),
+    approachStart_(0.0), approachSteps_(0), approachGeneration_(0), moveGeneration_(0)
+{
+  moveTimer_ = epicsTime::getCurrent();
+  ANC150ModelInit(&stepModel_);
+
+  /* The frequency is read and step mode set by ANC150Controller::initAxes(). */
+  commError_ = true;
+  nextVerify_ = moveTimer_;
+  snapshotSequence_ = 0;
+  publishSnapshot(moveTimer_, currentPosition_);
+  journalValid_ = false;
+
+  setIntegerParam(pC_->motorClosedLoop_, 1);
+  /* Set gain support on so the CNEN field works. */
+  setIntegerParam(pC_->motorStatusGainSupport_, 1);
+  /* The ANC150 has no limit or home switches. */
+  setIntegerParam(pC_->motorStatusHighLimit_, 0);
+  setIntegerParam(pC_->motorStatusLowLimit_, 0);
+  setIntegerParam(pC_->motorStatusAtHome_, 0);
+
+  // Make sure the axis's callParamCallbacks is called at least once
+  callParamCallbacks();
+}
+
+/** Reports on status of the axis
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * After printing device-specific information calls asynMotorAxis::report()
+  */
+void ANC150Axis::report(FILE *fp, int level)
+{
+  if (level > 0) {
+    fprintf(fp, "  axis %d\n", axisNo_);
+    fprintf(fp, "    frequency:   %d\n", frequency_);
+    fprintf(fp, "    step mode:   %s%s\n", stepMode_ ? "stp" : "gnd", cacheValid_ ? "" : " (unverified)");
+    fprintf(fp, "    position:    %f\n", currentPosition_);
+    fprintf(fp, "    target:      %f\n", targetPosition_);
+    fprintf(fp, "    high limit:  %f\n", highLimit_);
+    fprintf(fp, "    low limit:   %f\n", lowLimit_);
+    if (pasynUserFeedback_) {
+      fprintf(fp, "    measured:    %f%s\n", measuredPosition_, feedbackError_ ? " (read failed)" : "");
+      fprintf(fp, "    feedback:    scale=%f, offset=%f, tolerance=%f, max iterations=%d, settle=%f\n",
+              feedbackScale_, feedbackOffset_, tolerance_, maxIterations_, settleTime_);
+      fprintf(fp, "    approach:    %s, target=%f, iterations=%d\n",
+              approaching_ ? "active" : (approachFailed_ ? "failed" : "idle"), approachTarget_, iterations_);
+    }
+    fprintf(fp, "    step size:   down=%f up=%f at %d Hz\n", ANC150ModelGain(&stepModel_, false, frequency_),
+            ANC150ModelGain(&stepModel_, true, frequency_), frequency_);
+  }
+
+  // Call the base class method
+  asynMotorAxis::report(fp, level);
+}
+
+/** Moves at the frequency nearest to maxVelocity (steps/sec), within the range
+  * of "setf"; 0 keeps the current frequency.  The controller has no
+  * acceleration control, so acceleration is ignored.  The cached frequency is
+  * written through before the steps are sized, and "setf" is only sent, in the
+  * same burst as the step command, when the frequency changes.  As in poll(),
+  * the commands are sent with the controller lock released. */
+asynStatus ANC150Axis::move(double position, int relative, double minVelocity, double maxVelocity, double acceleration)
+{
+  ANC150Command cmds[2];
+  epicsTime start;
+  asynStatus status;
+  unsigned int generation;
+  long imove;
+  bool posdir, up;
+  bool setFrequency;
+  int nCmds = 0;
+  // static const char *functionName = "ANC150Axis::move";
+
+  ANC150LogPrint(pasynUser_, pC_->portName, axisNo_, ASYN_TRACE_FLOW,
+                 "move to %f, min vel=%f, max_vel=%f, accel=%f\n",
+                 position, minVelocity, maxVelocity, acceleration);
+
+  if (jogging_ || !pC_->ready_)
+    return(asynError);
+
+  up = relative ? (position >= 0.0) : (position >= currentPosition_);
+  setFrequency = (maxVelocity > 0.) && changeFrequency(velocityFrequency(maxVelocity, up));
+
+  if (pasynUserFeedback_) {
+    /* Closed loop; the poller corrects until the measured position is within tolerance. */
+    if (!startApproach(position, relative, &imove))
+      return(feedbackError_ ? asynError : asynSuccess);
+    posdir = (imove >= 0);
+  } else if (relative) {
+    /* Steps are sized by the step size model of the direction. */
+    posdir = (position >= 0.0);
+    targetPosition_ += position;
+    imove = NINT(position / ANC150ModelGain(&stepModel_, posdir, frequency_));
+  } else {
+    posdir = (position >= currentPosition_);
+    imove = NINT((position - currentPosition_) / ANC150ModelGain(&stepModel_, posdir, frequency_));
+    targetPosition_ = position;
+  }
+
+  moveGeneration_++;
+  if (pC_->movesDeferred_ || (pC_->mailboxEvent_ && !pasynUserFeedback_)) {
+    /* Sent with the other axes by ANC150Controller::setDeferredMoves(false),
+     * or by the mailbox dispatcher.  The newest target replaces a move that
+     * has not been sent yet; relative moves add up. */
+    if (deferredMove_) {
+      pC_->stats_.coalesced++;
+      if (relative && !pasynUserFeedback_) {
+        imove += deferredSteps_;
+        posdir = (imove >= 0);
+      }
+    }
+    deferredMove_ = true;
+    deferredSteps_ = imove;
+    deferredFrequency_ = deferredFrequency_ || setFrequency;
+    setIntegerParam(pC_->motorStatusDirection_, posdir);
+    if (!pC_->movesDeferred_)
+      epicsEventSignal(pC_->mailboxEvent_);
+    return(asynSuccess);
+  }
+
+  if (setFrequency)
+    sprintf(cmds[nCmds++].command, "setf %d %d", axisNo_ + 1, frequency_);
+  formatStep(imove, cmds[nCmds++].command);
+  generation = moveGeneration_;
+  start = epicsTime::getCurrent();
+  startTimer(imove, start);
+  pC_->unlock();
+  status = pC_->sendCommands(cmds, nCmds);
+  pC_->lock();
+  if (setFrequency)
+    frequencySent(&cmds[0]);
+  /* A stop() or a newer move made meanwhile owns the axis state. */
+  if (moveGeneration_ != generation)
+    return(cmds[nCmds - 1].status);
+  if (cmds[nCmds - 1].status != asynSuccess) {
+    moving_ = false;
+    targetPosition_ = currentPosition_;
+    if (approaching_)
+      endApproach(true);
+    return(status);
+  }
+
+  /* Set direction indicator. */
+  setIntegerParam(pC_->motorStatusDirection_, posdir);
+  journal();
+  return(asynSuccess);
+}
+
+/** Converts a velocity to the nearest step frequency within the range of "setf",
+  * through the step size model of the direction.  The model is binned by
+  * frequency, so the frequency is refined once with the step size at the first guess.
+  * \param[in] velocity The velocity (steps/sec); the sign is ignored.
+  * \param[in] up true for steps up. */
+int ANC150Axis::velocityFrequency(double velocity, bool up)
+{
+  long frequency = NINT(fabs(velocity));
+  int i;
+
+  for (i=0; i<2; i++) {
+    if (frequency < pC_->pProtocol_->minFrequency) frequency = pC_->pProtocol_->minFrequency;
+    if (frequency > pC_->pProtocol_->maxFrequency) frequency = pC_->pProtocol_->maxFrequency;
+    if (i == 0)
+      frequency = NINT(fabs(velocity) / ANC150ModelGain(&stepModel_, up, (int) frequency));
+  }
+  return((int) frequency);
+}
+
+/** Writes a new step frequency through to the cached frequency.
+  * Called with the controller lock held.
+  * \param[in] frequency The frequency of the next move.
+  * \return true if "setf" is to be sent: the frequency changed or the cache is not verified. */
+bool ANC150Axis::changeFrequency(int frequency)
+{
+  if (cacheValid_ && frequency == frequency_)
+    return(false);
+  frequency_ = frequency;
+  cacheGeneration_++;
+  return(true);
+}
+
+/** Checks the reply to a "setf" made by changeFrequency(); if it failed the
+  * cache is re-read by the next poll.  Called with the controller lock held. */
+void ANC150Axis::frequencySent(const ANC150Command *pCmd)
+{
+  if (pCmd->status == asynSuccess && pCmd->result.code == ANC150ResultOK)
+    return;
+  cacheValid_ = false;
+  cacheGeneration_++;
+}
+
+/** Formats the step command for a relative move.
+  * \param[in] steps The number of steps; negative steps down.
+  * \param[out] command The command string, at least ANC150_COMMAND_SIZE long. */
+void ANC150Axis::formatStep(long steps, char *command)
+{
+  sprintf(command, "%s %d %ld", (steps >= 0) ? "stepu" : "stepd", axisNo_ + 1, labs(steps));
+}
+
+/** Starts the simulated trajectory of a move.  Called with the controller lock held.
+  * \param[in] steps The number of steps of the move.
+  * \param[in] start The time at which the step command was sent. */
+void ANC150Axis::startTimer(long steps, const epicsTime &start)
+{
+  moving_ = true;
+  moveInterval_ = (frequency_ > 0) ? (double) labs(steps) / (double) frequency_ : 0.0;
+  if (moveInterval_ <= 0.0)
+    moveInterval_ = epicsThreadSleepQuantum();
+  moveTimer_ = start + moveInterval_;
+}
+
+asynStatus ANC150Axis::home(double minVelocity, double maxVelocity, double acceleration, int forwards)
+{
+  /* The ANC150 has no reference switch. */
+  return(asynError);
+}
+
+/** Steps continuously ("stepu n c" or "stepd n c") at the frequency nearest
+  * to maxVelocity (steps/sec), within the range of "setf".  The poller stops
+  * the axis once its simulated position passes a soft limit; the frequency the
+  * axis had before the jog is restored when the jog ends. */
+asynStatus ANC150Axis::moveVelocity(double minVelocity, double maxVelocity, double acceleration)
+{
+  ANC150Command cmds[2];
+  epicsTime start;
+  asynStatus status;
+  int direction = (maxVelocity >= 0.) ? 1 : -1;
+  int frequency = velocityFrequency(maxVelocity, direction > 0);
+  int nCmds = 0;
+
+  ANC150LogPrint(pasynUser_, pC_->portName, axisNo_, ASYN_TRACE_FLOW,
+                 "jog at %f, accel=%f\n", maxVelocity, acceleration);
+
+  if (!pC_->ready_ || jogging_ || approaching_ || pastLimit(currentPosition_ + direction, direction))
+    return(asynError);
+
+  /* As in changeFrequency(), a cache that is not known to be valid is rewritten. */
+  if (!cacheValid_ || frequency != frequency_)
+    sprintf(cmds[nCmds++].command, "setf %d %d", axisNo_ + 1, frequency);
+  sprintf(cmds[nCmds++].command, "%s %d c", (direction > 0) ? "stepu" : "stepd", axisNo_ + 1);
+  start = epicsTime::getCurrent();
+  status = pC_->sendCommands(cmds, nCmds);
+  if (cmds[nCmds - 1].status != asynSuccess) {
+    if (nCmds > 1)
+      cacheValid_ = false;
+    cacheGeneration_++;
+    return(status);
+  }
+
+  restoreFrequency_ = frequency_;
+  frequency_ = frequency;
+  if (nCmds > 1 && cmds[0].status != asynSuccess)
+    cacheValid_ = false;
+  cacheGeneration_++;
+  jogging_ = true;
+  jogDirection_ = direction;
+  jogStart_ = start + cmds[nCmds - 1].latency;
+  jogStartPosition_ = targetPosition_ = currentPosition_;
+  moving_ = true;
+  setIntegerParam(pC_->motorStatusDirection_, direction > 0);
+  return(asynSuccess);
+}
+
+/** Formats the commands that end a jog: "stop", and "setf" if the jog changed the frequency.
+  * \param[out] pCmds Room for two commands.
+  * \return The number of commands. */
+int ANC150Axis::formatJogStop(ANC150Command *pCmds)
+{
+  sprintf(pCmds[0].command, "stop %d", axisNo_ + 1);
+  if (restoreFrequency_ < pC_->pProtocol_->minFrequency || restoreFrequency_ == frequency_)
+    return(1);
+  sprintf(pCmds[1].command, "setf %d %d", axisNo_ + 1, restoreFrequency_);
+  return(2);
+}
+
+/** Ends a jog once its "stop" has been answered.  Called with the controller lock held.
+  * \param[in] stopTime The time at which the axis stopped.
+  * \param[in] pCmds The commands made by formatJogStop() and their replies.
+  * \param[in] nCmds The number of commands. */
+void ANC150Axis::endJog(const epicsTime &stopTime, const ANC150Command *pCmds, int nCmds)
+{
+  if (pCmds[0].status != asynSuccess)
+    return;
+  currentPosition_ = targetPosition_ = simPosition(stopTime);
+  jogging_ = false;
+  moveTimer_ = stopTime;
+  if (nCmds > 1) {
+    if (pCmds[1].status == asynSuccess)
+      frequency_ = restoreFrequency_;
+    else
+      cacheValid_ = false;
+    cacheGeneration_++;
+  }
+}
+
+/** Returns the speed of the current jog (steps/sec): the step frequency times
+  * the step size of the jog direction. */
+double ANC150Axis::jogSpeed()
+{
+  return(frequency_ * ANC150ModelGain(&stepModel_, jogDirection_ > 0, frequency_));
+}
+
+/** Returns the simulated position at a given time.
+  * \param[in] now The time. */
+double ANC150Axis::simPosition(const epicsTime &now)
+{
+  if (jogging_)
+    return jogStartPosition_ + jogDirection_ * jogSpeed() * (now - jogStart_);
+  if (moving_ && moveTimer_ > now && moveInterval_ > 0.0)
+    return currentPosition_ + (targetPosition_ - currentPosition_) * (1.0 - (moveTimer_ - now) / moveInterval_);
+  return targetPosition_;
+}
+
+/** Sets the position parameters of a moving axis from its simulated position.
+  * Called with the controller lock held; does not call callParamCallbacks().
+  * \param[in] now The current time.
+  * \return true if the axis is moving and its parameters were set. */
+bool ANC150Axis::publishPosition(const epicsTime &now)
+{
+  double position;
+
+  if (!moving_ || deferredMove_)
+    return(false);
+  position = simPosition(now);
+  setDoubleParam(pC_->motorPosition_, position);
+  /* The encoder position of a closed-loop axis only changes when it is measured. */
+  if (!pasynUserFeedback_)
+    setDoubleParam(pC_->motorEncoderPosition_, position);
+  publishSnapshot(now, position);
+  return(true);
+}
+
+/** Predicts when the axis stops by itself.  Called with the controller lock held.
+  * \param[out] pTime The end of the current move, the time a jog reaches a soft
+  *             limit, or the time the next approach measurement is due.
+  * \return false if the axis is idle, or jogging without limits. */
+bool ANC150Axis::predictStop(epicsTime *pTime)
+{
+  double limit;
+
+  if (jogging_) {
+    if (highLimit_ <= lowLimit_ || frequency_ <= 0)
+      return(false);
+    limit = (jogDirection_ > 0) ? highLimit_ : lowLimit_;
+    *pTime = jogStart_ + (limit - jogStartPosition_) * jogDirection_ / jogSpeed();
+    return(true);
+  }
+  if (approaching_ && !deferredMove_) {
+    *pTime = moveTimer_ + settleTime_;
+    return(true);
+  }
+  if (moving_ && !deferredMove_) {
+    *pTime = moveTimer_;
+    return(true);
+  }
+  return(false);
+}
+
+/** Returns true if a position is at or past the soft limit in the direction
+  * of travel, so an axis beyond one limit can still move back into range.
+  * The limits are only enforced when the high limit is above the low limit;
+  * the motor record sends 0 for both when they are disabled.
+  * \param[in] position The position (steps).
+  * \param[in] direction 1 up, -1 down. */
+bool ANC150Axis::pastLimit(double position, int direction)
+{
+  if (highLimit_ <= lowLimit_)
+    return(false);
+  return((direction > 0) ? position >= highLimit_ : position <= lowLimit_);
+}
+
+/** Stops the axis.  A jog is ended and its frequency restored; a move is
+  * frozen at its simulated position.  The commands are sent with the
+  * controller lock released. */
+asynStatus ANC150Axis::stop(double acceleration)
+{
+  ANC150Command cmds[2];
+  epicsTime now;
+  asynStatus status;
+  unsigned int generation;
+  char buff[ANC150_BUFFER_SIZE];
+  int nCmds;
+
+  ANC150LogPrint(pasynUser_, pC_->portName, axisNo_, ASYN_TRACE_FLOW,
+                 "stop with accel=%f\n", acceleration);
+
+  /* A move that has not been sent yet is dropped. */
+  if (deferredMove_) {
+    deferredMove_ = false;
+    targetPosition_ = currentPosition_;
+    pC_->stats_.preempted++;
+    /* Its "setf" was not sent either; re-read the frequency. */
+    if (deferredFrequency_) {
+      deferredFrequency_ = false;
+      cacheValid_ = false;
+      cacheGeneration_++;
+    }
+  }
+  approaching_ = false;
+  approachGeneration_++;
+  generation = ++moveGeneration_;
+
+  if (jogging_) {
+    nCmds = formatJogStop(cmds);
+    now = epicsTime::getCurrent();
+    pC_->unlock();
+    pC_->sendCommands(cmds, nCmds);
+    pC_->lock();
+    /* The poller may have ended the jog at a soft limit meanwhile. */
+    if (jogging_)
+      endJog(now + cmds[0].latency, cmds, nCmds);
+    journal();
+    return(cmds[0].status);
+  }
+
+  sprintf(buff, "stop %d", axisNo_ + 1);
+  now = epicsTime::getCurrent();
+  pC_->unlock();
+  status = pC_->sendOnly(buff);
+  pC_->lock();
+  if (status)
+    return(status);
+
+  /* Freeze the simulated position where the steps stopped; the move is done,
+   * unless a newer move was started meanwhile. */
+  if (moving_ && moveGeneration_ == generation) {
+    currentPosition_ = targetPosition_ = simPosition(now);
+    moveTimer_ = now;
+  }
+  journal();
+  return(asynSuccess);
+}
+
+asynStatus ANC150Axis::setPosition(double position)
+{
+  /* A closed-loop axis keeps its position source and offsets it instead. */
+  if (pasynUserFeedback_) {
+    feedbackOffset_ += position - measuredPosition_;
+    measuredPosition_ = approachTarget_ = position;
+  }
+  currentPosition_ = targetPosition_ = position;
+  journal();
+  return(asynSuccess);
+}
+
+/** Stores the high soft limit, enforced by the poller on jogs.
+  * \param[in] highLimit The limit (steps). */
+asynStatus ANC150Axis::setHighLimit(double highLimit)
+{
+  highLimit_ = highLimit;
+  return(asynSuccess);
+}
+
+/** Stores the low soft limit, enforced by the poller on jogs.
+  * \param[in] lowLimit The limit (steps). */
+asynStatus ANC150Axis::setLowLimit(double lowLimit)
+{
+  lowLimit_ = lowLimit;
+  return(asynSuccess);
+}
+
+asynStatus ANC150Axis::setClosedLoop(bool closedLoop)
+{
+  char buff[ANC150_BUFFER_SIZE];
+  asynStatus status;
+
+  /* The startup thread puts every axis in step mode. */
+  if (!pC_->ready_)
+    return(asynError);
+  if (closedLoop)
+    sprintf(buff, "setm %d stp", axisNo_ + 1);
+  else
+    sprintf(buff, "setm %d gnd", axisNo_ + 1);
+  pC_->unlock();
+  status = pC_->sendOnly(buff);
+  pC_->lock();
+
+  /* Write through to the cached mode; if the write failed the controller
+   * state is unknown and is re-read on the next poll. */
+  if (status == asynSuccess) {
+    stepMode_ = closedLoop;
+    setIntegerParam(pC_->motorStatusPowerOn_, stepMode_ ? 1 : 0);
+  }
+  else
+    cacheValid_ = false;
+  cacheGeneration_++;
+  return(status);
+}
+
+/** Updates the parameter library from the simulated position and cached state.
+  * Called from ANC150Controller::poll() with the controller lock held; does not
+  * call callParamCallbacks(). */
+void ANC150Axis::updateStatus()
+{
+  epicsTime now = epicsTime::getCurrent();
+  double slewposition;
+
+  if (deferredMove_) {
+    slewposition = currentPosition_;
+  } else {
+    slewposition = simPosition(now);
+    if (moving_ && !jogging_ && moveTimer_ <= now)
+      moving_ = false;
+    if (!moving_)
+      currentPosition_ = targetPosition_;
+  }
+
+  /* A deferred move is reported as not done until it has been sent and completed,
+   * an approach until the measured position is within tolerance. */
+  setIntegerParam(pC_->motorStatusDone_, !moving_ && !deferredMove_ && !approaching_);
+  setIntegerParam(pC_->motorStatusMoving_, moving_ || approaching_);
+  setDoubleParam(pC_->motorPosition_, slewposition);
+  setDoubleParam(pC_->motorEncoderPosition_, pasynUserFeedback_ ? measuredPosition_ : slewposition);
+  setIntegerParam(pC_->motorStatusProblem_, approachFailed_ || feedbackError_);
+  ANC150LogPrint(pasynUser_, pC_->portName, axisNo_, ASYN_TRACEIO_DRIVER,
+                 "ANC150Controller::poll: position=%f\n", slewposition);
+
+  setIntegerParam(pC_->motorStatusCommsError_, commError_ ? 1 : 0);
+  setIntegerParam(pC_->motorStatusPowerOn_, stepMode_ ? 1 : 0);
+  publishSnapshot(now, slewposition);
+  journal();
+}
+
+/** Publishes the status of the axis for readSnapshot().  Called with the
+  * controller lock held, so there is only one writer at a time.  The snapshot
+  * is a sequence lock: the sequence number is odd while it is written. */
+void ANC150Axis::publishSnapshot(const epicsTime &now, double position)
+{
+  epicsAtomicIncrIntT(&snapshotSequence_);
+  epicsAtomicWriteMemoryBarrier();
+  snapshot_.position = position;
+  snapshot_.encoderPosition = pasynUserFeedback_ ? measuredPosition_ : position;
+  snapshot_.done = !moving_ && !deferredMove_ && !approaching_;
+  snapshot_.moving = moving_ || approaching_;
+  snapshot_.highLimit = (highLimit_ > lowLimit_) && position >= highLimit_;
+  snapshot_.lowLimit = (highLimit_ > lowLimit_) && position <= lowLimit_;
+  snapshot_.powerOn = stepMode_;
+  snapshot_.commError = commError_;
+  snapshot_.problem = approachFailed_ || feedbackError_;
+  snapshot_.frequency = frequency_;
+  snapshot_.time = now;
+  epicsAtomicWriteMemoryBarrier();
+  epicsAtomicIncrIntT(&snapshotSequence_);
+}
+
+/** Copies the last status published by the poller.  Does not take the
+  * controller lock, so it never waits for a poll or a serial transaction;
+  * the copy is retried if the poller published a new status meanwhile.
+  * \param[out] pSnapshot The status. */
+void ANC150Axis::readSnapshot(ANC150AxisSnapshot *pSnapshot)
+{
+  int sequence;
+
+  while (true) {
+    sequence = epicsAtomicGetIntT(&snapshotSequence_);
+    if (sequence & 1) {
+      epicsThreadSleep(0.0);
+      continue;
+    }
+    epicsAtomicReadMemoryBarrier();
+    *pSnapshot = snapshot_;
+    epicsAtomicReadMemoryBarrier();
+    if (epicsAtomicGetIntT(&snapshotSequence_) == sequence)
+      return;
+  }
+}
+
+/** Commits state read by ANC150Controller::poll() to the cache.
+  * Called with the controller lock held.  If the cache was written through while
+  * the read was in progress the staged values are older than the cache and are
+  * discarded. */
+void ANC150Axis::commitState(const ANC150AxisState *pState)
+{
+  nextVerify_ = epicsTime::getCurrent() + pC_->verifyPollPeriod_;
+  if (pState->generation != cacheGeneration_)
+    return;
+  frequency_ = pState->frequency;
+  stepMode_ = pState->stepMode;
+  commError_ = (pState->status != asynSuccess);
+  cacheValid_ = !commError_;
+}
+
+/** Reports the moving state computed by the last ANC150Controller::poll().
+  * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false). */
+asynStatus ANC150Axis::poll(bool *moving)
+{
+  *moving = moving_ || approaching_;
+  return asynSuccess;
+}
+
+/** Parses a comma separated list of numbers.
+  * \return The number of values, or -1 if the list is malformed or too long. */
+static int parseList(const char *list, double *values, int maxValues)
+{
+  const char *p = list;
+  char *end;
+  int n = 0;
+
+  while (p && *p) {
+    if (n == maxValues)
+      return(-1);
+    values[n++] = strtod(p, &end);
+    if (end == p)
+      return(-1);
+    for (p = end; *p == ',' || *p == ' '; p++)
+      ;
+  }
+  return(n);
+}
+
+/** Moves several axes of one controller with a single burst of step commands.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName  The asyn port name given to ANC150CreateController
+  * \param[in] axes      Comma separated axis index numbers, e.g. "0,1,2"
+  * \param[in] positions Comma separated positions in steps, one per axis
+  * \param[in] relative  0 for absolute positions, 1 for relative
+  */
+extern "C" int ANC150GroupMove(const char *portName, const char *axes, const char *positions, int relative)
+{
+  ANC150Controller *pC;
+  double axisList[ANC150_MAX_AXES];
+  double positionList[ANC150_MAX_AXES];
+  int axisNumbers[ANC150_MAX_AXES];
+  int nAxes, i;
+  asynStatus status;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150GroupMove: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  nAxes = parseList(axes, axisList, ANC150_MAX_AXES);
+  if (nAxes < 1 || parseList(positions, positionList, ANC150_MAX_AXES) != nAxes) {
+    printf("ANC150GroupMove: need one position for each of 1 to %d axes\n", ANC150_MAX_AXES);
+    return(asynError);
+  }
+  for (i=0; i<nAxes; i++)
+    axisNumbers[i] = (int) axisList[i];
+
+  status = pC->groupMove(nAxes, axisNumbers, positionList, relative);
+  if (status != asynSuccess)
+    printf("ANC150GroupMove: move failed, status=%d\n", status);
+  return(status);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150CreateControllerArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150CreateControllerArg1 = {"ANC150 port name", iocshArgString};
+static const iocshArg ANC150CreateControllerArg2 = {"Number of axes", iocshArgInt};
+static const iocshArg ANC150CreateControllerArg3 = {"Moving poll period (ms)", iocshArgInt};
+static const iocshArg ANC150CreateControllerArg4 = {"Idle poll period (ms)", iocshArgInt};
+static const iocshArg ANC150CreateControllerArg5 = {"Verify poll period (ms)", iocshArgInt};
+static const iocshArg ANC150CreateControllerArg6 = {"Position publish period (ms)", iocshArgInt};
+static const iocshArg * const ANC150CreateControllerArgs[] = {&ANC150CreateControllerArg0,
+                                                              &ANC150CreateControllerArg1,
+                                                              &ANC150CreateControllerArg2,
+                                                              &ANC150CreateControllerArg3,
+                                                              &ANC150CreateControllerArg4,
+                                                              &ANC150CreateControllerArg5,
+                                                              &ANC150CreateControllerArg6};
+static const iocshFuncDef ANC150CreateControllerDef = {"ANC150CreateController", 7, ANC150CreateControllerArgs};
+static void ANC150CreateControllerCallFunc(const iocshArgBuf *args)
+{
+  ANC150CreateController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival,
+                         args[5].ival, args[6].ival);
+}
+
+static const iocshArg ANC300CreateControllerArg1 = {"ANC300 port name", iocshArgString};
+static const iocshArg * const ANC300CreateControllerArgs[] = {&ANC150CreateControllerArg0,
+                                                              &ANC300CreateControllerArg1,
+                                                              &ANC150CreateControllerArg2,
+                                                              &ANC150CreateControllerArg3,
+                                                              &ANC150CreateControllerArg4,
+                                                              &ANC150CreateControllerArg5,
+                                                              &ANC150CreateControllerArg6};
+static const iocshFuncDef ANC300CreateControllerDef = {"ANC300CreateController", 7, ANC300CreateControllerArgs};
+static void ANC300CreateControllerCallFunc(const iocshArgBuf *args)
+{
+  ANC300CreateController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival,
+                         args[5].ival, args[6].ival);
+}
+
+static const iocshArg ANC150GroupMoveArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150GroupMoveArg1 = {"Axes", iocshArgString};
+static const iocshArg ANC150GroupMoveArg2 = {"Positions", iocshArgString};
+static const iocshArg ANC150GroupMoveArg3 = {"Relative", iocshArgInt};
+static const iocshArg * const ANC150GroupMoveArgs[] = {&ANC150GroupMoveArg0,
+                                                       &ANC150GroupMoveArg1,
+                                                       &ANC150GroupMoveArg2,
+                                                       &ANC150GroupMoveArg3};
+static const iocshFuncDef ANC150GroupMoveDef = {"ANC150GroupMove", 4, ANC150GroupMoveArgs};
+static void ANC150GroupMoveCallFunc(const iocshArgBuf *args)
+{
+  ANC150GroupMove(args[0].sval, args[1].sval, args[2].sval, args[3].ival);
+}
+
+/** Waits for all ANC150 controllers to finish their startup and prints the time each took.
+  * Called from iocsh, typically after iocInit
+  * \param[in] timeout The longest time in seconds to wait; 0 to print at once
+  */
+extern "C" int ANC150StartupSummary(double timeout)
+{
+  return(ANC150Controller::startupSummary(timeout));
+}
+
+/** Prints the status snapshot of every axis of a controller.  Does not take
+  * the controller lock, so it answers while a poll or serial transaction hangs.
+  * \param[in] portName The asyn port name given to ANC150CreateController
+  */
+extern "C" int ANC150Status(const char *portName)
+{
+  ANC150Controller *pC;
+  ANC150AxisSnapshot snapshot;
+  ANC150Axis *pAxis;
+  epicsTime now = epicsTime::getCurrent();
+  int axis;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150Status: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  printf("  axis     position      encoder done moving limits power comm problem frequency    age(s)\n");
+  /* getAxis() returns NULL past the last axis. */
+  for (axis=0; axis<ANC150_MAX_AXES; axis++) {
+    pAxis = pC->getAxis(axis);
+    if (!pAxis) break;
+    pAxis->readSnapshot(&snapshot);
+    printf("  %4d %12.1f %12.1f %4d %6d %3s%3s %5d %4d %7d %9d %9.3f\n", axis, snapshot.position,
+           snapshot.encoderPosition, snapshot.done, snapshot.moving, snapshot.lowLimit ? "lo" : "--",
+           snapshot.highLimit ? "hi" : "--", snapshot.powerOn, snapshot.commError, snapshot.problem,
+           snapshot.frequency, now - snapshot.time);
+  }
+  return(asynSuccess);
+}
+
+static const iocshArg ANC150StatusArg0 = {"Port name", iocshArgString};
+static const iocshArg * const ANC150StatusArgs[] = {&ANC150StatusArg0};
+static const iocshFuncDef ANC150StatusDef = {"ANC150Status", 1, ANC150StatusArgs};
+static void ANC150StatusCallFunc(const iocshArgBuf *args)
+{
+  ANC150Status(args[0].sval);
+}
+
+static const iocshArg ANC150StartupSummaryArg0 = {"Timeout (sec)", iocshArgDouble};
+static const iocshArg * const ANC150StartupSummaryArgs[] = {&ANC150StartupSummaryArg0};
+static const iocshFuncDef ANC150StartupSummaryDef = {"ANC150StartupSummary", 1, ANC150StartupSummaryArgs};
+static void ANC150StartupSummaryCallFunc(const iocshArgBuf *args)
+{
+  ANC150StartupSummary(args[0].dval);
+}
+
+static void ANC150Register(void)
+{
+  iocshRegister(&ANC150CreateControllerDef, ANC150CreateControllerCallFunc);
+  iocshRegister(&ANC300CreateControllerDef, ANC300CreateControllerCallFunc);
+  iocshRegister(&ANC150GroupMoveDef, ANC150GroupMoveCallFunc);
+  iocshRegister(&ANC150StartupSummaryDef, ANC150StartupSummaryCallFunc);
+  iocshRegister(&ANC150StatusDef, ANC150StatusCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150Register);
+}
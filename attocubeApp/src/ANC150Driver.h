@@ -0,0 +1,370 @@
+/*
+FILENAME...     ANC150Driver.h
+USAGE...        Motor driver support (model 3) for the attocube systems AG ANC150
+                Piezo Step Controller.
+
+*/
+
+#ifndef ANC150Driver_H
+#define ANC150Driver_H
+
+#include "epicsTime.h"
+#include "epicsMutex.h"
+#include "epicsEvent.h"
+
+#include "asynMotorController.h"
+#include "asynMotorAxis.h"
+
+#include "ANC150Parser.h"
+#include "ANC150StepModel.h"
+#include "ANC150Timeout.h"
+#include "ANC150Journal.h"
+
+class ANC150PollerPool;
+struct ANC150PollerEntry;
+
+#define ANC150_MAX_AXES 7           /* Most axes of any supported model (ANC300) */
+#define ANC150_BUFFER_SIZE 100      /* Size of input and output buffers */
+#define ANC150_COMMAND_SIZE 32      /* Size of a single command string */
+#define ANC150_MAX_PIPELINE 8       /* Maximum number of commands in flight */
+#define ANC150_EOS_SIZE 4           /* Room for the output EOS between pipelined commands */
+#define ANC150_MIN_TIMEOUT 0.02     /* Shortest I/O timeout of links without a baud rate (sec) */
+#define ANC150_LONG_TIMEOUT 5.0     /* Default longest timeout of long commands (sec) */
+#define ANC150_VERIFY_PERIOD 10.0   /* Default time between re-reads of cached axis state (sec) */
+#define ANC150_FEEDBACK_TIMEOUT 1.0 /* Timeout for reads of an external position source (sec) */
+#define ANC150_MODEL_SAVE_PERIOD 10.0 /* Minimum time between saves of the step size models (sec) */
+#define ANC150_DISCONNECT_FAILURES 3 /* Consecutive unanswered transactions that mark the link down */
+#define ANC150_PROBE_MIN 0.5        /* First and longest delays between "ver" probes of a down link (sec) */
+#define ANC150_PROBE_MAX 30.0
+
+/** State of the link to the controller.  Degraded after a transaction goes
+  * unanswered, disconnected after ANC150_DISCONNECT_FAILURES in a row. */
+typedef enum {
+  ANC150LinkConnected,
+  ANC150LinkDegraded,
+  ANC150LinkDisconnected
+} ANC150LinkState;
+
+/** A command sent with ANC150Controller::sendCommands() and its decoded reply. */
+typedef struct ANC150Command {
+  char command[ANC150_COMMAND_SIZE];
+  const ANC150CommandDef *pDef; /* Command table entry; set by sendCommands(). */
+  ANC150Result result;
+  asynStatus status;
+  double latency;             /* Time from the write of the burst to the reply (sec). */
+} ANC150Command;
+
+/** Axis state read from the controller by ANC150Controller::poll() without
+  * the controller lock held and committed to the axis once it is re-taken. */
+typedef struct ANC150AxisState {
+  bool verify;                /* This axis is to be re-read. */
+  unsigned int generation;    /* ANC150Axis::cacheGeneration_ when the read started. */
+  int command;                /* Index of the axis's first command in the burst. */
+  int jogCommand;             /* Index of the axis's jog "stop" in the burst. */
+  int nJogCommands;           /* Commands that stop a jog at a soft limit; 0 if none. */
+  asynStatus status;
+  int frequency;
+  bool stepMode;
+  bool feedback;              /* The axis has an external position source. */
+  asynStatus feedbackStatus;
+  double feedbackRaw;         /* Value read from the position source. */
+  int approachCommand;        /* Index of the axis's approach correction in the second burst; -1 if none. */
+  unsigned int approachGeneration; /* ANC150Axis::approachGeneration_ when the correction was computed. */
+} ANC150AxisState;
+
+/* Latency histogram bins; upper edges in ms are 1, 2, 5, 10, 20, 50, 100,
+ * 200, 500, 1000, 2000 and the last bin holds everything slower. */
+#define ANC150_HIST_BINS 12
+
+/** Transport and poll statistics.  The transport fields are updated with
+  * ioLock_ held, the poll fields with the controller lock held. */
+typedef struct ANC150Stats {
+  epicsInt32 histogram[ANC150NumCmdClasses][ANC150_HIST_BINS];
+  double latencySum[ANC150NumCmdClasses];
+  double latencyMax[ANC150NumCmdClasses];
+  int count[ANC150NumCmdClasses];
+  int timeouts;               /* Transactions that timed out. */
+  int errors;                 /* Transactions that failed for other reasons. */
+  int discards;               /* Reply frames that matched no outstanding command. */
+  int retries;                /* Handshake retries. */
+  int reconnects;             /* Links restored after a disconnection. */
+  int coalesced;              /* Pending moves superseded by a newer target before they were sent. */
+  int preempted;              /* Pending moves dropped by stop. */
+  int pollOverruns;           /* Polls that took longer than the moving poll period. */
+  int polls;                  /* Status polls made. */
+  double pollTime;            /* Duration of the last poll (sec). */
+  double pollPeriod;          /* Time between the starts of the last two polls (sec). */
+  double pollJitter;          /* Smoothed absolute change of pollPeriod (sec). */
+  double groupSkew;           /* Reply spread of the last deferred move burst (sec). */
+  epicsTime lastPollStart;
+  bool havePoll;
+} ANC150Stats;
+
+/** Status of an axis, published by the poller for readers that must not take
+  * the controller lock; see ANC150Axis::readSnapshot(). */
+typedef struct ANC150AxisSnapshot {
+  double position;            /* Steps. */
+  double encoderPosition;     /* Measured position of a closed-loop axis, else position. */
+  bool done;
+  bool moving;
+  bool highLimit;             /* At or past a soft limit. */
+  bool lowLimit;
+  bool powerOn;               /* Step mode. */
+  bool commError;
+  bool problem;
+  int frequency;              /* Cached step frequency (Hz). */
+  epicsTime time;             /* Time the snapshot was taken. */
+} ANC150AxisSnapshot;
+
+/** drvInfo strings for extra parameters that the ANC150 controller supports */
+#define ANC150CommandsString        "ANC150_COMMANDS"
+#define ANC150TimeoutsString        "ANC150_TIMEOUTS"
+#define ANC150ErrorsString          "ANC150_ERRORS"
+#define ANC150DiscardsString        "ANC150_DISCARDS"
+#define ANC150RetriesString         "ANC150_RETRIES"
+#define ANC150PollOverrunsString    "ANC150_POLL_OVERRUNS"
+#define ANC150PollTimeString        "ANC150_POLL_TIME"
+#define ANC150PollPeriodString      "ANC150_POLL_PERIOD"
+#define ANC150PollJitterString      "ANC150_POLL_JITTER"
+#define ANC150QueryHistString       "ANC150_QUERY_HIST"
+#define ANC150SetHistString         "ANC150_SET_HIST"
+#define ANC150MoveHistString        "ANC150_MOVE_HIST"
+#define ANC150StopHistString        "ANC150_STOP_HIST"
+#define ANC150ProfileStartTimesString "ANC150_PROFILE_START_TIMES"
+#define ANC150ProfileMaxLateString  "ANC150_PROFILE_MAX_LATE"
+#define ANC150GroupSkewString       "ANC150_GROUP_SKEW"
+#define ANC150LinkStateString       "ANC150_LINK_STATE"
+#define ANC150ReconnectsString      "ANC150_RECONNECTS"
+#define ANC150IoTimeoutString       "ANC150_IO_TIMEOUT"
+#define ANC150CoalescedString       "ANC150_COALESCED"
+#define ANC150PreemptedString       "ANC150_PREEMPTED"
+
+class epicsShareClass ANC150Axis : public asynMotorAxis
+{
+public:
+  /* These are the methods we override from the base class */
+  ANC150Axis(class ANC150Controller *pC, int axis);
+  void report(FILE *fp, int level);
+  asynStatus move(double position, int relative, double min_velocity, double max_velocity, double acceleration);
+  asynStatus moveVelocity(double min_velocity, double max_velocity, double acceleration);
+  asynStatus home(double min_velocity, double max_velocity, double acceleration, int forwards);
+  asynStatus stop(double acceleration);
+  asynStatus poll(bool *moving);
+  asynStatus setPosition(double position);
+  asynStatus setHighLimit(double highLimit);
+  asynStatus setLowLimit(double lowLimit);
+  asynStatus setClosedLoop(bool closedLoop);
+  asynStatus configFeedback(const char *sourcePort, int sourceAddr, const char *drvInfo, double scale,
+                            double tolerance, int maxIterations, double settleTime);
+  void readSnapshot(ANC150AxisSnapshot *pSnapshot);
+
+private:
+  ANC150Controller *pC_;      /**< Pointer to the asynMotorController to which this axis belongs.
+                                *   Abbreviated because it is used very frequently */
+  void updateStatus();
+  void commitState(const ANC150AxisState *pState);
+  int velocityFrequency(double velocity, bool up);
+  bool changeFrequency(int frequency);
+  void frequencySent(const ANC150Command *pCmd);
+  void formatStep(long steps, char *command);
+  void startTimer(long steps, const epicsTime &start);
+  double jogSpeed();
+  double simPosition(const epicsTime &now);
+  bool pastLimit(double position, int direction);
+  int formatJogStop(ANC150Command *pCmds);
+  void endJog(const epicsTime &stopTime, const ANC150Command *pCmds, int nCmds);
+  bool predictStop(epicsTime *pTime);
+  bool publishPosition(const epicsTime &now);
+  void publishSnapshot(const epicsTime &now, double position);
+  void journal();
+  asynStatus readFeedback(double *pRaw);
+  void commitFeedback(asynStatus status, double raw);
+  long approachSteps(double error);
+  bool startApproach(double position, int relative, long *pSteps);
+  bool approachDue(const epicsTime &now);
+  bool approachStep(char *command);
+  void approachSent(const ANC150Command *pCmd, const epicsTime &start, unsigned int generation);
+  void endApproach(bool failed);
+
+  double targetPosition_;
+  double currentPosition_;
+  double highLimit_;
+  double lowLimit_;
+  bool moving_;               /* Moving indicator. */
+  epicsTime moveTimer_;       /* Time at which the simulated move completes. */
+  double moveInterval_;       /* Moving delta time (sec). */
+  int frequency_;             /* Step frequency (Hz) as last read with "getf" or written with "setf". */
+  bool stepMode_;             /* Cached mode; true = "stp", false = "gnd". */
+  bool commError_;            /* Last verify of the cached state failed. */
+  bool cacheValid_;           /* frequency_ and stepMode_ match the controller. */
+  epicsTime nextVerify_;      /* Time at which the cached state is re-read. */
+  unsigned int cacheGeneration_; /* Incremented by every write-through to the cache. */
+  bool deferredMove_;         /* A move is waiting for ANC150Controller::setDeferredMoves(false). */
+  long deferredSteps_;        /* Steps of the deferred move. */
+  bool deferredFrequency_;    /* The deferred move sends "setf" first. */
+  bool jogging_;              /* Stepping continuously ("stepu n c"). */
+  int jogDirection_;          /* 1 up, -1 down. */
+  epicsTime jogStart_;        /* Time the continuous stepping started. */
+  double jogStartPosition_;
+  int restoreFrequency_;      /* Frequency to restore with "setf" when the jog ends. */
+  asynUser *pasynUserFeedback_; /* External position source; NULL if the axis is open loop. */
+  double feedbackScale_;      /* Steps per unit of the position source. */
+  double feedbackOffset_;     /* Added to the scaled position source (steps). */
+  double tolerance_;          /* An approach ends within this distance of its target (steps). */
+  int maxIterations_;         /* Corrections an approach may make before it fails. */
+  double settleTime_;         /* Time from the end of a burst to the next measurement (sec). */
+  double measuredPosition_;   /* Last value of the position source (steps). */
+  bool feedbackError_;        /* The last read of the position source failed. */
+  bool approaching_;          /* Correcting towards approachTarget_. */
+  bool approachFailed_;       /* The last approach ended outside the tolerance. */
+  double approachTarget_;
+  int iterations_;            /* Corrections made by the current approach. */
+  double approachStart_;      /* Measured position before the last burst. */
+  long approachSteps_;        /* Steps of the last burst. */
+  int snapshotSequence_;      /* Odd while snapshot_ is being written. */
+  ANC150AxisSnapshot snapshot_;
+  bool journalValid_;         /* journaled_ holds the state last written to the journal. */
+  ANC150JournalState journaled_;
+  ANC150StepModel stepModel_; /* Measured step size per direction and frequency. */
+  unsigned int approachGeneration_; /* Incremented by every new approach and by stop(). */
+  unsigned int moveGeneration_; /* Incremented by every move and by stop(). */
+
+friend class ANC150Controller;
+};
+
+class epicsShareClass ANC150Controller : public asynMotorController {
+public:
+  ANC150Controller(const char *portName, const char *ANC150PortName, int numAxes,
+                   double movingPollPeriod, double idlePollPeriod, double verifyPollPeriod,
+                   double publishPeriod, const ANC150Protocol *pProtocol = &ANC150ProtocolANC150);
+
+  void report(FILE *fp, int level);
+  asynStatus poll();
+  asynStatus startPoller(double movingPollPeriod, double idlePollPeriod, int forcedFastPolls);
+  asynStatus wakeupPoller();
+  void initThread();
+  static int startupSummary(double timeout);
+  void pollerThread();
+  bool pollerStep(bool woken, epicsTime *pDeadline, bool *pHaveDeadline);
+  asynStatus readInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements, size_t *nIn);
+  asynStatus readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nIn);
+  ANC150Axis* getAxis(asynUser *pasynUser);
+  ANC150Axis* getAxis(int axisNo);
+  asynStatus setDeferredMoves(bool defer);
+  asynStatus loadStepModel(const char *fileName);
+  void configTimeouts(double minTimeout, double maxTimeout, double longTimeout);
+  const ANC150Protocol *protocol() { return pProtocol_; }
+  double minTimeout() { return minTimeout_; }
+  asynStatus openJournal(const char *fileName);
+  asynStatus groupMove(int nAxes, const int *axes, const double *positions, int relative);
+
+  /* These are the methods for profile moves */
+  asynStatus initializeProfile(size_t maxPoints);
+  asynStatus buildProfile();
+  asynStatus executeProfile();
+  asynStatus abortProfile();
+  void profileThread();
+
+  /* These are the methods for the move mailbox */
+  asynStatus createMailbox();
+  void dispatcherThread();
+  void shutdownMailbox();
+
+  /* These are the hooks for the benchmark (ANC150Bench.cpp) */
+  asynStatus sendCommands(ANC150Command *pCmds, int nCmds);
+  void pausePoller(bool pause);
+  void invalidateCache(int nAxes);
+  void readStats(ANC150Stats *pStats);
+  double maxTimeout();
+  const char *ioPortName() { return ANC150PortName_; }
+  int numAxes() { return numAxes_; }
+  bool ready() { return ready_; }
+
+protected:
+  int ANC150Commands_;
+#define FIRST_ANC150_PARAM ANC150Commands_
+  int ANC150Timeouts_;
+  int ANC150Errors_;
+  int ANC150Discards_;
+  int ANC150Retries_;
+  int ANC150PollOverruns_;
+  int ANC150PollTime_;
+  int ANC150PollPeriod_;
+  int ANC150PollJitter_;
+  int ANC150QueryHist_;
+  int ANC150SetHist_;
+  int ANC150MoveHist_;
+  int ANC150StopHist_;
+  int ANC150ProfileStartTimes_;
+  int ANC150ProfileMaxLate_;
+  int ANC150GroupSkew_;
+  int ANC150LinkState_;
+  int ANC150Reconnects_;
+  int ANC150IoTimeout_;
+  int ANC150Coalesced_;
+  int ANC150Preempted_;
+#define LAST_ANC150_PARAM ANC150Preempted_
+
+private:
+  bool handshake();
+  void initAxes(bool restore);
+  void linkResult(bool answered);
+  ANC150LinkState linkState();
+  void reconnect(const epicsTime &now);
+  asynStatus sendOnly(const char *outputBuff);
+  asynStatus sendAndReceive(const char *outputBuff, char *inputBuff, size_t inputSize);
+  asynStatus getFreq(int axis, int *frequency);
+  bool stpMode(int axis);
+  void recordLatency(const ANC150CommandDef *pDef, double latency);
+  void recordPoll(const epicsTime &start);
+  void publishStats();
+  void runProfile();
+  void publishPositions();
+  void saveStepModel(const epicsTime &now);
+  int formatDeferredMoves(ANC150Command *pCmds, ANC150Axis **pAxes, int *pNFrequencies);
+  void dispatchMoves();
+
+  char firmwareVersion_[ANC150_BUFFER_SIZE];
+  char ANC150PortName_[ANC150_BUFFER_SIZE];
+  double verifyPollPeriod_;   /* Time between re-reads of cached axis state (sec). */
+  double publishPeriod_;      /* Time between position updates of moving axes (sec); 0 for none. */
+  epicsMutexId ioLock_;       /* Serializes transactions on the serial port. */
+  ANC150Stats stats_;
+  bool movesDeferred_;        /* Moves are collected for one burst. */
+  epicsEventId profileStartEvent_;  /* Signalled by executeProfile(). */
+  epicsEventId profileAbortEvent_;  /* Signalled by abortProfile(). */
+  volatile bool profileAborted_;
+  double *profileStartTimes_; /* Actual start of the move to each point, from the start of the schedule (sec). */
+  ANC150PollerPool *pPollerPool_; /* Shared poller threads; NULL if the controller has its own. */
+  struct ANC150PollerEntry *pPollerEntry_;
+  epicsTime nextStatus_;      /* Poller schedule, kept between poller steps. */
+  epicsTime nextPublish_;
+  bool anyMoving_;
+  bool statusPoll_;           /* The next step is a status poll rather than a position publish. */
+  int fastPolls_;             /* Forced fast polls left. */
+  char *stepModelFile_;       /* File the step size models are saved to; NULL for none. */
+  bool stepModelDirty_;       /* A step size model has changed since it was saved. */
+  epicsTime nextStepModelSave_;
+  bool ready_;                /* The handshake and axis initialization are complete. */
+  epicsTime createTime_;
+  double timeToReady_;        /* Time from creation to ready (sec). */
+  ANC150Controller *pNextController_; /* Next in the list of all ANC150 controllers. */
+  ANC150LinkState link_;      /* The link fields are protected by ioLock_. */
+  int linkFailures_;          /* Unanswered transactions in a row. */
+  bool probing_;              /* A handshake is in progress; I/O is allowed while disconnected. */
+  double probeDelay_;         /* Current delay between probes of a down link (sec). */
+  epicsTime nextProbe_;
+  ANC150Rtt rtt_[ANC150NumTimeoutClasses]; /* Adaptive timeouts; protected by ioLock_. */
+  ANC150Journal *pJournal_;   /* Position journal; NULL for none. */
+  const ANC150Protocol *pProtocol_; /* Traits of the controller model. */
+  epicsEventId mailboxEvent_; /* Signalled when a move is posted; NULL if moves are sent at once. */
+  double minTimeout_;         /* Default shortest I/O timeout; see linkMinTimeout() (sec). */
+  bool pollerPaused_;         /* The poller makes no status polls; see pausePoller(). */
+  bool pollerStepping_;       /* A poller step is in progress, perhaps with the lock released. */
+
+friend class ANC150Axis;
+};
+
+#define NUM_ANC150_PARAMS ((int)(&LAST_ANC150_PARAM - &FIRST_ANC150_PARAM + 1))
+
+#endif /* ANC150Driver_H */
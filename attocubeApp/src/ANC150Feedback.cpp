@@ -0,0 +1,312 @@
+/*
+FILENAME...     ANC150Feedback.cpp
+USAGE...        Closed-loop positioning of ANC150 axes from an external position
+                source.
+
+*/
+
+/*
+ * The ANC150 is open loop; the driver only counts steps.  An axis can be
+ * bound to an external position source, any asyn port with an asynFloat64
+ * interface (an interferometer, a capacitive sensor, or the simulator's
+ * ANC150SimSensor port), with ANC150ConfigFeedback().  The source is read by
+ * every status poll, scaled to steps and reported as the encoder position.
+ *
+ * A move of such an axis is an approach: a first "stepu"/"stepd" burst
+ * sized from the error to the last polled measurement, then, each time the burst has ended and the
+ * stage has settled, a new measurement and a correction, until the measured
+ * position is within the tolerance of the target or the iteration limit is
+ * reached.  Slip-stick steps are not the same size up and down, so the
+ * measured step size of each direction is learnt, per frequency, into the
+ * axis's step size model (ANC150StepModel.cpp) from the bursts large enough
+ * to measure it, and used to size the next burst, which is what keeps the
+ * number of iterations small.  A failed approach sets motorStatusProblem.
+ *
+ * The corrections are computed by ANC150Controller::poll() with the controller
+ * lock held and sent in a second burst with it released, like the poll's
+ * queries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <epicsTime.h>
+#include <iocsh.h>
+
+#include <asynFloat64SyncIO.h>
+
+#include "ANC150Driver.h"
+#include "ANC150Log.h"
+#include <epicsExport.h>
+
+#define NINT(f) (long)((f)>0 ? (f)+0.5 : (f)-0.5)       /* Nearest integer. */
+
+#define ANC150_GAIN_MIN_STEPS 10    /* Smallest burst from which the step size is learnt */
+
+/** Binds the axis to an external position source.  Called with the controller lock held.
+  * \param[in] sourcePort    The asyn port of the position source.
+  * \param[in] sourceAddr    The asyn address on that port.
+  * \param[in] drvInfo       The drvInfo string of the position parameter; may be NULL.
+  * \param[in] scale         Steps per unit of the position source.
+  * \param[in] tolerance     An approach ends within this distance of its target (steps).
+  * \param[in] maxIterations Corrections an approach may make before it fails.
+  * \param[in] settleTime    Time from the end of a burst to the next measurement (sec). */
+asynStatus ANC150Axis::configFeedback(const char *sourcePort, int sourceAddr, const char *drvInfo, double scale,
+                                      double tolerance, int maxIterations, double settleTime)
+{
+  asynUser *pasynUser;
+  asynStatus status;
+  double raw;
+
+  status = pasynFloat64SyncIO->connect(sourcePort, sourceAddr, &pasynUser, drvInfo);
+  if (status) {
+    asynPrint(pasynUser_, ASYN_TRACE_ERROR,
+              "ANC150Axis::configFeedback: cannot connect to %s address %d\n", sourcePort, sourceAddr);
+    return(status);
+  }
+  pasynUserFeedback_ = pasynUser;
+  feedbackScale_ = scale;
+  feedbackOffset_ = 0.0;
+  tolerance_ = tolerance;
+  maxIterations_ = maxIterations;
+  settleTime_ = settleTime;
+
+  status = readFeedback(&raw);
+  commitFeedback(status, raw);
+  if (status == asynSuccess)
+    currentPosition_ = targetPosition_ = approachTarget_ = measuredPosition_;
+  setIntegerParam(pC_->motorStatusHasEncoder_, 1);
+  return(asynSuccess);
+}
+
+/** Reads the position source.  May be called without the controller lock held.
+  * \param[out] pRaw The unscaled value. */
+asynStatus ANC150Axis::readFeedback(double *pRaw)
+{
+  return(pasynFloat64SyncIO->read(pasynUserFeedback_, pRaw, ANC150_FEEDBACK_TIMEOUT));
+}
+
+/** Stores a value read from the position source.  Called with the controller lock held.
+  * \param[in] status The status of the read.
+  * \param[in] raw The unscaled value. */
+void ANC150Axis::commitFeedback(asynStatus status, double raw)
+{
+  if (status != asynSuccess && !feedbackError_)
+    asynPrint(pasynUser_, ASYN_TRACE_ERROR,
+              "ANC150Axis::commitFeedback: axis %d position source read failed, status=%d, error=%s\n",
+              axisNo_, status, pasynUserFeedback_->errorMessage);
+  feedbackError_ = (status != asynSuccess);
+  if (!feedbackError_)
+    measuredPosition_ = raw * feedbackScale_ + feedbackOffset_;
+}
+
+/** Returns the number of steps expected to cover a distance, from the learnt step size.
+  * At least one step is taken.
+  * \param[in] error The distance (steps of the position source); negative down. */
+long ANC150Axis::approachSteps(double error)
+{
+  long steps = NINT(error / ANC150ModelGain(&stepModel_, error > 0.0, frequency_));
+
+  if (steps == 0)
+    steps = (error > 0.0) ? 1 : -1;
+  return(steps);
+}
+
+/** Starts an approach from the last measurement of the status poll.  The
+  * source is not read here: move() holds the controller lock, and a read can
+  * take up to ANC150_FEEDBACK_TIMEOUT.  The axis is at rest between moves, and
+  * the corrections make up for any drift since the poll.
+  * Called from move() with the controller lock held.
+  * \param[in] position The target, or the distance from the measured position if relative.
+  * \param[in] relative 0 for an absolute target, 1 for relative.
+  * \param[out] pSteps The steps of the first burst.
+  * \return true if a burst is to be sent; false if the axis is already within
+  *         the tolerance or the position source could not be read. */
+bool ANC150Axis::startApproach(double position, int relative, long *pSteps)
+{
+  approachGeneration_++;
+  approachTarget_ = relative ? measuredPosition_ + position : position;
+  iterations_ = 0;
+  approaching_ = true;
+  if (feedbackError_) {
+    endApproach(true);
+    return(false);
+  }
+  if (fabs(approachTarget_ - measuredPosition_) <= tolerance_) {
+    endApproach(false);
+    return(false);
+  }
+  *pSteps = approachSteps(approachTarget_ - measuredPosition_);
+  approachStart_ = measuredPosition_;
+  approachSteps_ = *pSteps;
+  currentPosition_ = measuredPosition_;
+  targetPosition_ = measuredPosition_ + *pSteps * ANC150ModelGain(&stepModel_, *pSteps > 0, frequency_);
+  return(true);
+}
+
+/** Returns true if the last burst of an approach has ended and settled, so
+  * the next measurement decides the next correction.
+  * \param[in] now The start of the poll. */
+bool ANC150Axis::approachDue(const epicsTime &now)
+{
+  return(approaching_ && !deferredMove_ && !jogging_ && moveTimer_ + settleTime_ <= now);
+}
+
+/** Decides the next step of an approach from the position just measured.
+  * Called from ANC150Controller::poll() with the controller lock held.
+  * \param[out] command The correction, at least ANC150_COMMAND_SIZE long.
+  * \return true if a correction is to be sent; false if the approach has ended. */
+bool ANC150Axis::approachStep(char *command)
+{
+  double gain, error;
+  long steps;
+
+  if (feedbackError_) {
+    endApproach(true);
+    return(false);
+  }
+
+  /* Learn the step size of the last burst's direction from what it achieved. */
+  if (labs(approachSteps_) >= ANC150_GAIN_MIN_STEPS) {
+    gain = (measuredPosition_ - approachStart_) / approachSteps_;
+    if (ANC150ModelUpdate(&stepModel_, approachSteps_ > 0, frequency_, gain))
+      pC_->stepModelDirty_ = true;
+  }
+
+  error = approachTarget_ - measuredPosition_;
+  if (fabs(error) <= tolerance_) {
+    endApproach(false);
+    return(false);
+  }
+  if (iterations_ >= maxIterations_) {
+    endApproach(true);
+    return(false);
+  }
+
+  steps = approachSteps(error);
+  formatStep(steps, command);
+  iterations_++;
+  approachStart_ = measuredPosition_;
+  approachSteps_ = steps;
+  currentPosition_ = measuredPosition_;
+  targetPosition_ = measuredPosition_ + steps * ANC150ModelGain(&stepModel_, steps > 0, frequency_);
+  return(true);
+}
+
+/** Starts the simulated trajectory of a correction once it has been sent.
+  * Called from ANC150Controller::poll() with the controller lock held.
+  * \param[in] pCmd The correction and its reply.
+  * \param[in] start The time at which the burst was sent.
+  * \param[in] generation approachGeneration_ when the correction was computed. */
+void ANC150Axis::approachSent(const ANC150Command *pCmd, const epicsTime &start, unsigned int generation)
+{
+  char buff[ANC150_COMMAND_SIZE];
+
+  if (generation != approachGeneration_) {
+    /* The axis was stopped while the burst was in flight; stop it again.  A
+     * newer approach needs nothing, it measures where the burst left it. */
+    if (!approaching_ && pCmd->status == asynSuccess) {
+      sprintf(buff, "stop %d", axisNo_ + 1);
+      pC_->sendOnly(buff);
+    }
+    return;
+  }
+  if (pCmd->status != asynSuccess) {
+    endApproach(true);
+    return;
+  }
+  startTimer(approachSteps_, start);
+  setIntegerParam(pC_->motorStatusDirection_, approachSteps_ > 0);
+}
+
+/** Ends an approach.  Called with the controller lock held.
+  * \param[in] failed true if the axis is not within the tolerance of the target. */
+void ANC150Axis::endApproach(bool failed)
+{
+  ANC150LogPrint(pasynUser_, pC_->portName, axisNo_, failed ? ASYN_TRACE_ERROR : ASYN_TRACE_FLOW,
+                 "ANC150Axis::endApproach: %s after %d corrections, target=%f measured=%f\n",
+                 failed ? "failed" : "in position", iterations_, approachTarget_, measuredPosition_);
+  approaching_ = false;
+  approachFailed_ = failed;
+  if (!feedbackError_)
+    currentPosition_ = targetPosition_ = measuredPosition_;
+}
+
+/** Binds an axis of an ANC150 controller to an external position source.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName      The asyn port name given to ANC150CreateController
+  * \param[in] axis          The axis index number, 0 to numAxes-1
+  * \param[in] sourcePort    The asyn port of the position source (asynFloat64)
+  * \param[in] sourceAddr    The asyn address on that port
+  * \param[in] drvInfo       The drvInfo string of the position parameter; "" for none
+  * \param[in] scale         Steps per unit of the position source
+  * \param[in] tolerance     An approach ends within this distance of its target (steps)
+  * \param[in] maxIterations Corrections an approach may make before it fails
+  * \param[in] settleTime    Time in ms from the end of a burst to the next measurement
+  */
+extern "C" int ANC150ConfigFeedback(const char *portName, int axis, const char *sourcePort, int sourceAddr,
+                                    const char *drvInfo, double scale, double tolerance, int maxIterations,
+                                    int settleTime)
+{
+  ANC150Controller *pC;
+  ANC150Axis *pAxis;
+  asynStatus status;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150ConfigFeedback: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  pAxis = pC->getAxis(axis);
+  if (!pAxis || !sourcePort) {
+    printf("ANC150ConfigFeedback: invalid axis %d or position source\n", axis);
+    return(asynError);
+  }
+  if (scale == 0.0 || tolerance < 0.0 || maxIterations < 0 || settleTime < 0) {
+    printf("ANC150ConfigFeedback: scale must be non-zero and tolerance, iterations and settle time positive\n");
+    return(asynError);
+  }
+  pC->lock();
+  status = pAxis->configFeedback(sourcePort, sourceAddr, (drvInfo && drvInfo[0]) ? drvInfo : NULL,
+                                 scale, tolerance, maxIterations, settleTime/1000.);
+  pAxis->callParamCallbacks();
+  pC->unlock();
+  return(status);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150ConfigFeedbackArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150ConfigFeedbackArg1 = {"Axis", iocshArgInt};
+static const iocshArg ANC150ConfigFeedbackArg2 = {"Source port name", iocshArgString};
+static const iocshArg ANC150ConfigFeedbackArg3 = {"Source address", iocshArgInt};
+static const iocshArg ANC150ConfigFeedbackArg4 = {"Source drvInfo", iocshArgString};
+static const iocshArg ANC150ConfigFeedbackArg5 = {"Steps per source unit", iocshArgDouble};
+static const iocshArg ANC150ConfigFeedbackArg6 = {"Tolerance (steps)", iocshArgDouble};
+static const iocshArg ANC150ConfigFeedbackArg7 = {"Max iterations", iocshArgInt};
+static const iocshArg ANC150ConfigFeedbackArg8 = {"Settle time (ms)", iocshArgInt};
+static const iocshArg * const ANC150ConfigFeedbackArgs[] = {&ANC150ConfigFeedbackArg0,
+                                                            &ANC150ConfigFeedbackArg1,
+                                                            &ANC150ConfigFeedbackArg2,
+                                                            &ANC150ConfigFeedbackArg3,
+                                                            &ANC150ConfigFeedbackArg4,
+                                                            &ANC150ConfigFeedbackArg5,
+                                                            &ANC150ConfigFeedbackArg6,
+                                                            &ANC150ConfigFeedbackArg7,
+                                                            &ANC150ConfigFeedbackArg8};
+static const iocshFuncDef ANC150ConfigFeedbackDef = {"ANC150ConfigFeedback", 9, ANC150ConfigFeedbackArgs};
+static void ANC150ConfigFeedbackCallFunc(const iocshArgBuf *args)
+{
+  ANC150ConfigFeedback(args[0].sval, args[1].ival, args[2].sval, args[3].ival, args[4].sval,
+                       args[5].dval, args[6].dval, args[7].ival, args[8].ival);
+}
+
+static void ANC150FeedbackRegister(void)
+{
+  iocshRegister(&ANC150ConfigFeedbackDef, ANC150ConfigFeedbackCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150FeedbackRegister);
+}
@@ -0,0 +1,269 @@
+/*
+FILENAME...     ANC150Journal.cpp
+USAGE...        Memory-mapped position journal for the attocube systems AG
+                ANC150 Piezo Step Controller.
+
+*/
+
+/*
+ * The ANC150 has no position readback, so an open-loop axis's position only
+ * exists in the driver.  ANC150OpenJournal(portName, fileName), called after
+ * ANC150CreateController and before iocInit, maps a small file that holds
+ * the committed position, move target, frequency and mode of every axis.
+ * The axes write it, with the controller lock held, when a move starts, is
+ * stopped or completes, when the position is set and when the cached state
+ * changes; a write is a few stores to the mapping and an msync(MS_ASYNC), so
+ * it costs no serial I/O and does not wait for the disk.
+ *
+ * Every axis has two slots written alternately, each with a sequence number
+ * and a checksum, so a write torn by a crash leaves the previous slot valid.
+ * When the journal is opened the newest valid slot of every axis is
+ * restored, before the first poll.  A move that was in progress is restored
+ * at its target, since the controller makes the steps of a burst by itself;
+ * an interrupted jog is restored at its start.  The cached frequency and mode
+ * are restored too, unless the startup thread has already read them from the
+ * controller, which it does in any case.
+ *
+ * Memory-mapped files need POSIX; on other targets the command fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(vxWorks)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define ANC150_HAVE_MMAP
+#endif
+
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include <epicsExport.h>
+
+/** FNV-1a hash of a slot, up to its checksum. */
+static epicsUInt32 slotChecksum(const ANC150JournalSlot *pSlot)
+{
+  const unsigned char *p = (const unsigned char *) pSlot;
+  epicsUInt32 hash = 2166136261u;
+  size_t i;
+
+  for (i=0; i<offsetof(ANC150JournalSlot, checksum); i++)
+    hash = (hash ^ p[i]) * 16777619u;
+  return(hash);
+}
+
+static ANC150JournalSlot *axisSlots(ANC150Journal *pJournal, int axis)
+{
+  return((ANC150JournalSlot *) ((char *) pJournal->base + sizeof(ANC150JournalHeader)) + 2 * axis);
+}
+
+/** Finds the current slot of an axis.
+  * \return 0 or 1, or -1 if neither slot is valid. */
+static int currentSlot(ANC150Journal *pJournal, int axis)
+{
+  ANC150JournalSlot *pSlots = axisSlots(pJournal, axis);
+  bool valid0 = (pSlots[0].checksum == slotChecksum(&pSlots[0]));
+  bool valid1 = (pSlots[1].checksum == slotChecksum(&pSlots[1]));
+
+  if (valid0 && valid1)
+    return((epicsInt32) (pSlots[1].sequence - pSlots[0].sequence) > 0 ? 1 : 0);
+  if (valid0)
+    return(0);
+  if (valid1)
+    return(1);
+  return(-1);
+}
+
+/** Opens or creates a journal file and maps it.  A file of another layout
+  * or number of axes is cleared.
+  * \return The journal, or NULL if the file cannot be mapped. */
+ANC150Journal *ANC150JournalOpen(const char *fileName, int numAxes)
+{
+#ifdef ANC150_HAVE_MMAP
+  ANC150Journal *pJournal;
+  ANC150JournalHeader *pHeader;
+  size_t size = sizeof(ANC150JournalHeader) + 2 * numAxes * sizeof(ANC150JournalSlot);
+  struct stat info;
+  void *base;
+  int fd;
+
+  fd = open(fileName, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return(NULL);
+  if (fstat(fd, &info) != 0 || ((size_t) info.st_size != size && ftruncate(fd, size) != 0)) {
+    close(fd);
+    return(NULL);
+  }
+  base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return(NULL);
+  }
+
+  pJournal = (ANC150Journal *) calloc(1, sizeof(ANC150Journal));
+  pJournal->fd = fd;
+  pJournal->base = base;
+  pJournal->size = size;
+  pJournal->numAxes = numAxes;
+  pHeader = (ANC150JournalHeader *) base;
+  pJournal->restored = ((size_t) info.st_size == size && pHeader->magic == ANC150_JOURNAL_MAGIC &&
+                        pHeader->version == ANC150_JOURNAL_VERSION && (int) pHeader->numAxes == numAxes);
+  if (!pJournal->restored) {
+    memset(base, 0, size);
+    pHeader->magic = ANC150_JOURNAL_MAGIC;
+    pHeader->version = ANC150_JOURNAL_VERSION;
+    pHeader->numAxes = numAxes;
+    msync(base, size, MS_ASYNC);
+  }
+  return(pJournal);
+#else
+  return(NULL);
+#endif
+}
+
+/** Reads the current state of an axis.
+  * \return false if the axis has no valid slot. */
+bool ANC150JournalRead(ANC150Journal *pJournal, int axis, ANC150JournalState *pState)
+{
+  ANC150JournalSlot *pSlot;
+  int slot = currentSlot(pJournal, axis);
+
+  if (slot < 0)
+    return(false);
+  pSlot = &axisSlots(pJournal, axis)[slot];
+  pState->position = pSlot->position;
+  pState->target = pSlot->target;
+  pState->frequency = pSlot->frequency;
+  pState->stepMode = (pSlot->flags & ANC150_JOURNAL_STEP_MODE) != 0;
+  pState->moving = (pSlot->flags & ANC150_JOURNAL_MOVING) != 0;
+  return(true);
+}
+
+/** Writes the state of an axis to the slot that is not current. */
+void ANC150JournalWrite(ANC150Journal *pJournal, int axis, const ANC150JournalState *pState)
+{
+  ANC150JournalSlot *pSlots = axisSlots(pJournal, axis);
+  ANC150JournalSlot slot;
+  int current = currentSlot(pJournal, axis);
+  int next = (current == 0) ? 1 : 0;
+
+  memset(&slot, 0, sizeof(slot));
+  slot.sequence = (current < 0) ? 1 : pSlots[current].sequence + 1;
+  slot.flags = (pState->stepMode ? ANC150_JOURNAL_STEP_MODE : 0) | (pState->moving ? ANC150_JOURNAL_MOVING : 0);
+  slot.position = pState->position;
+  slot.target = pState->target;
+  slot.frequency = pState->frequency;
+  slot.checksum = slotChecksum(&slot);
+  pSlots[next] = slot;
+#ifdef ANC150_HAVE_MMAP
+  msync(pJournal->base, pJournal->size, MS_ASYNC);
+#endif
+}
+
+/** Writes the axis's state to the journal if it has changed.  Called with the controller lock held. */
+void ANC150Axis::journal()
+{
+  ANC150JournalState state;
+
+  if (!pC_->pJournal_)
+    return;
+  state.position = currentPosition_;
+  state.target = targetPosition_;
+  state.frequency = frequency_;
+  state.stepMode = stepMode_;
+  state.moving = moving_ || deferredMove_;
+  if (journalValid_ && state.position == journaled_.position && state.target == journaled_.target &&
+      state.frequency == journaled_.frequency && state.stepMode == journaled_.stepMode &&
+      state.moving == journaled_.moving)
+    return;
+  ANC150JournalWrite(pC_->pJournal_, axisNo_, &state);
+  journaled_ = state;
+  journalValid_ = true;
+}
+
+/** Opens the position journal and restores the axes from it.  Called with the controller lock held.
+  * \param[in] fileName The journal file; created if it does not exist. */
+asynStatus ANC150Controller::openJournal(const char *fileName)
+{
+  ANC150JournalState state;
+  ANC150Axis *pAxis;
+  int axis, nRestored = 0;
+
+  if (pJournal_) {
+    printf("ANC150OpenJournal: %s already has a journal\n", portName);
+    return(asynError);
+  }
+  pJournal_ = ANC150JournalOpen(fileName, numAxes_);
+  if (!pJournal_) {
+    printf("ANC150OpenJournal: cannot map %s\n", fileName);
+    return(asynError);
+  }
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pJournal_->restored || !ANC150JournalRead(pJournal_, axis, &state))
+      continue;
+    pAxis->currentPosition_ = pAxis->targetPosition_ = state.moving ? state.target : state.position;
+    if (!ready_) {
+      /* A startup read in flight is older than the journal; the poll re-reads the state. */
+      pAxis->frequency_ = state.frequency;
+      pAxis->stepMode_ = state.stepMode;
+      pAxis->cacheGeneration_++;
+    }
+    pAxis->updateStatus();
+    pAxis->callParamCallbacks();
+    nRestored++;
+  }
+  for (axis=0; axis<numAxes_; axis++)
+    getAxis(axis)->journal();
+  printf("ANC150OpenJournal: %s: %d of %d axes restored from %s\n", portName, nRestored, numAxes_, fileName);
+  return(asynSuccess);
+}
+
+/** Opens the position journal of a controller and restores its axes.
+  * Configuration command, called directly or from iocsh, before iocInit
+  * \param[in] portName The asyn port name given to ANC150CreateController
+  * \param[in] fileName The journal file
+  */
+extern "C" int ANC150OpenJournal(const char *portName, const char *fileName)
+{
+  ANC150Controller *pC;
+  asynStatus status;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150OpenJournal: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  if (!fileName || !fileName[0]) {
+    printf("ANC150OpenJournal: a file name is required\n");
+    return(asynError);
+  }
+  pC->lock();
+  status = pC->openJournal(fileName);
+  pC->unlock();
+  return(status);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150OpenJournalArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150OpenJournalArg1 = {"File name", iocshArgString};
+static const iocshArg * const ANC150OpenJournalArgs[] = {&ANC150OpenJournalArg0,
+                                                         &ANC150OpenJournalArg1};
+static const iocshFuncDef ANC150OpenJournalDef = {"ANC150OpenJournal", 2, ANC150OpenJournalArgs};
+static void ANC150OpenJournalCallFunc(const iocshArgBuf *args)
+{
+  ANC150OpenJournal(args[0].sval, args[1].sval);
+}
+
+static void ANC150JournalRegister(void)
+{
+  iocshRegister(&ANC150OpenJournalDef, ANC150OpenJournalCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150JournalRegister);
+}
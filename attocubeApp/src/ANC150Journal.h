@@ -0,0 +1,62 @@
+/*
+FILENAME...     ANC150Journal.h
+USAGE...        Memory-mapped position journal for the attocube systems AG
+                ANC150 Piezo Step Controller.
+
+*/
+
+#ifndef ANC150Journal_H
+#define ANC150Journal_H
+
+#include <stddef.h>
+
+#include "epicsTypes.h"
+
+#define ANC150_JOURNAL_MAGIC 0x4a434e41 /* "ANCJ" */
+#define ANC150_JOURNAL_VERSION 1
+
+/** Journaled state of an axis. */
+typedef struct ANC150JournalState {
+  double position;            /* Committed position (steps). */
+  double target;              /* Target of the move in progress; position if none. */
+  int frequency;              /* Cached step frequency (Hz). */
+  bool stepMode;              /* Cached mode; true = "stp". */
+  bool moving;
+} ANC150JournalState;
+
+/** A slot of the journal file.  Each axis has two, written alternately; the
+  * valid slot with the higher sequence is current. */
+typedef struct ANC150JournalSlot {
+  epicsUInt32 sequence;
+  epicsUInt32 flags;          /* ANC150_JOURNAL_STEP_MODE, ANC150_JOURNAL_MOVING */
+  double position;
+  double target;
+  epicsInt32 frequency;
+  epicsUInt32 checksum;       /* FNV-1a of the fields above. */
+} ANC150JournalSlot;
+
+#define ANC150_JOURNAL_STEP_MODE 0x1
+#define ANC150_JOURNAL_MOVING    0x2
+
+/** Start of the journal file; followed by 2 slots per axis. */
+typedef struct ANC150JournalHeader {
+  epicsUInt32 magic;
+  epicsUInt32 version;
+  epicsUInt32 numAxes;
+  epicsUInt32 reserved;
+} ANC150JournalHeader;
+
+/** An open journal. */
+typedef struct ANC150Journal {
+  int fd;
+  void *base;                 /* The mapped file. */
+  size_t size;
+  int numAxes;
+  bool restored;              /* The file held a journal of the same layout when opened. */
+} ANC150Journal;
+
+ANC150Journal *ANC150JournalOpen(const char *fileName, int numAxes);
+bool ANC150JournalRead(ANC150Journal *pJournal, int axis, ANC150JournalState *pState);
+void ANC150JournalWrite(ANC150Journal *pJournal, int axis, const ANC150JournalState *pState);
+
+#endif /* ANC150Journal_H */
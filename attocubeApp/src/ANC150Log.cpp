@@ -0,0 +1,376 @@
+/*
+FILENAME...     ANC150Log.cpp
+USAGE...        Asynchronous trace log of the attocube systems AG ANC150 driver.
+
+*/
+
+/*
+ * asynPrint formats and writes its message in the calling thread, so with
+ * tracing on, the poller and the port threads wait for the console.
+ * ANC150LogPrint() checks the port's asyn trace mask and the log's own
+ * runtime mask, then stores the format, its arguments, the time, port and
+ * axis in a preallocated ring and returns.  A thread formats the records
+ * and writes them every ANC150_LOG_FLUSH_PERIOD to the asyn trace file of
+ * the asynUser they were logged with (asynSetTraceFile; errlog if none),
+ * prefixed as the asyn trace info mask selects: the time, the port and axis,
+ * and the thread (ASYN_TRACEINFO_SOURCE is not available).  Writers never
+ * block: when the ring is full the record is dropped and counted.
+ *
+ * The ring is a bounded multi-producer queue: a writer claims a position by
+ * compare-and-swap on the head and publishes the slot by setting its
+ * sequence to the position + 1; the log thread, the only reader, frees the
+ * slot by setting its sequence to the position + ANC150_LOG_RECORDS.
+ *
+ * Only the first ANC150_LOG_MAX_ARGS conversions of a format are logged,
+ * and %s arguments share ANC150_LOG_TEXT_SIZE bytes; the rest of the format
+ * is written as text.  So is the rest of a format from a conversion with a
+ * '*' width or a length modifier other than h, hh and l (ll, z, j, t, L),
+ * whose argument types the ring does not store.
+ *
+ * ANC150LogMask(mask) sets the runtime mask (asyn trace bits; -1, the
+ * default, for all) and prints the number of records logged and dropped.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <epicsThread.h>
+#include <epicsAtomic.h>
+#include <epicsStdio.h>
+#include <errlog.h>
+#include <iocsh.h>
+
+#include "ANC150Log.h"
+#include <epicsExport.h>
+
+static ANC150LogRecord records[ANC150_LOG_RECORDS];
+static size_t head;                  /* Next position to write. */
+static size_t tail;                  /* Next position to read; log thread only. */
+static size_t logged;
+static size_t dropped;
+static int logMask = -1;
+static epicsThreadOnceId logOnce = EPICS_THREAD_ONCE_INIT;
+
+static void logThread(void *pPvt);
+
+static void logInit(void *pPvt)
+{
+  size_t i;
+
+  for (i=0; i<ANC150_LOG_RECORDS; i++)
+    records[i].sequence = i;
+  epicsThreadCreate("ANC150Log", epicsThreadPriorityLow,
+                    epicsThreadGetStackSize(epicsThreadStackSmall),
+                    (EPICSTHREADFUNC) logThread, NULL);
+}
+
+/** Finds the next conversion of a format.
+  * \param[in] format The format, from just after the previous conversion.
+  * \param[out] pLength The length of the conversion, from the '%'.
+  * \return The '%' of the conversion, or NULL if there is none. */
+static const char *nextConversion(const char *format, size_t *pLength)
+{
+  const char *p;
+
+  for (p = strchr(format, '%'); p; p = strchr(p + 2, '%')) {
+    if (p[1] != '%')
+      break;
+  }
+  if (!p)
+    return(NULL);
+  *pLength = 1 + strspn(p + 1, "-+ #0123456789.hlLqjzt");
+  if (p[*pLength])
+    (*pLength)++;
+  return(p);
+}
+
+/** Returns the length modifier of a conversion that the ring can store.
+  * \param[in] p The '%' of the conversion.
+  * \param[in] length The length of the conversion.
+  * \return 0 for none, 'h' for h and hh, 'l' for l, or -1 for any other
+  *         modifier, or one that does not apply to the conversion. */
+static int lengthModifier(const char *p, size_t length)
+{
+  size_t n = 0;
+  char type = p[length - 1];
+
+  while (n + 2 < length && strchr("hlLqjzt", p[length - 2 - n]))
+    n++;
+  if (n == 0)
+    return(0);
+  if (strchr("diuxXo", type)) {
+    if ((n == 1 || (n == 2 && p[length - 3] == 'h')) && p[length - 2] == 'h')
+      return('h');
+    if (n == 1 && p[length - 2] == 'l')
+      return('l');
+  }
+  /* %lf is the same as %f. */
+  if (strchr("feEgG", type) && n == 1 && p[length - 2] == 'l')
+    return('l');
+  return(-1);
+}
+
+/** Logs a message without formatting or writing it in the calling thread.
+  * \param[in] pasynUser The asynUser whose trace mask enables the message.
+  * \param[in] portName The port the message is about; must not be freed.
+  * \param[in] axis The axis, or -1.
+  * \param[in] mask The asyn trace reason, e.g. ASYN_TRACE_FLOW.
+  * \param[in] format A printf format; must not be freed.
+  * \return false if the message was dropped because the log was full. */
+bool ANC150LogPrint(asynUser *pasynUser, const char *portName, int axis, int mask, const char *format, ...)
+{
+  ANC150LogRecord *pRecord;
+  const char *p, *s;
+  size_t pos, seq, length, textUsed = 0, n;
+  char type;
+  int infoMask, modifier;
+  va_list args;
+
+  if (!(mask & epicsAtomicGetIntT(&logMask)) || !(mask & pasynTrace->getTraceMask(pasynUser)))
+    return(true);
+  epicsThreadOnce(&logOnce, logInit, NULL);
+
+  pos = epicsAtomicGetSizeT(&head);
+  while (true) {
+    pRecord = &records[pos & (ANC150_LOG_RECORDS - 1)];
+    seq = epicsAtomicGetSizeT(&pRecord->sequence);
+    if (seq == pos) {
+      if (epicsAtomicCmpAndSwapSizeT(&head, pos, pos + 1) == pos)
+        break;
+      pos = epicsAtomicGetSizeT(&head);
+    }
+    else if ((long) (seq - pos) < 0) {
+      epicsAtomicIncrSizeT(&dropped);
+      return(false);
+    }
+    else
+      pos = epicsAtomicGetSizeT(&head);
+  }
+
+  epicsTimeGetCurrent(&pRecord->time);
+  infoMask = pasynTrace->getTraceInfoMask(pasynUser);
+  pRecord->infoMask = infoMask;
+  pRecord->thread[0] = 0;
+  if (infoMask & ASYN_TRACEINFO_THREAD) {
+    strncpy(pRecord->thread, epicsThreadGetNameSelf(), sizeof(pRecord->thread) - 1);
+    pRecord->thread[sizeof(pRecord->thread) - 1] = 0;
+  }
+  pRecord->pasynUser = pasynUser;
+  pRecord->portName = portName;
+  pRecord->format = format;
+  pRecord->axis = axis;
+  pRecord->mask = mask;
+  pRecord->nArgs = 0;
+  va_start(args, format);
+  for (p = nextConversion(format, &length); p && pRecord->nArgs < ANC150_LOG_MAX_ARGS;
+       p = nextConversion(p + length, &length)) {
+    type = p[length - 1];
+    modifier = lengthModifier(p, length);
+    if (memchr(p, '*', length) || modifier < 0)
+      break;
+    switch (type) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+      if (modifier == 'l')
+        pRecord->args[pRecord->nArgs].l = va_arg(args, long);
+      else
+        pRecord->args[pRecord->nArgs].l = va_arg(args, int);
+      break;
+    case 'f': case 'e': case 'E': case 'g': case 'G':
+      pRecord->args[pRecord->nArgs].d = va_arg(args, double);
+      break;
+    case 'p':
+      pRecord->args[pRecord->nArgs].p = va_arg(args, void *);
+      break;
+    case 's':
+      s = va_arg(args, const char *);
+      if (!s)
+        s = "(null)";
+      n = strlen(s);
+      if (n > ANC150_LOG_TEXT_SIZE - 1 - textUsed)
+        n = ANC150_LOG_TEXT_SIZE - 1 - textUsed;
+      memcpy(&pRecord->text[textUsed], s, n);
+      pRecord->text[textUsed + n] = 0;
+      pRecord->args[pRecord->nArgs].offset = (int) textUsed;
+      textUsed += n + ((textUsed + n < ANC150_LOG_TEXT_SIZE - 1) ? 1 : 0);
+      break;
+    default:
+      type = 0;
+      break;
+    }
+    if (!type)
+      break;
+    pRecord->types[pRecord->nArgs++] = type;
+  }
+  va_end(args);
+
+  epicsAtomicWriteMemoryBarrier();
+  epicsAtomicSetSizeT(&pRecord->sequence, pos + 1);
+  epicsAtomicIncrSizeT(&logged);
+  return(true);
+}
+
+/** A line being formatted; output past its size is dropped. */
+typedef struct ANC150LogLine {
+  char text[ANC150_LOG_LINE_SIZE];
+  size_t length;
+} ANC150LogLine;
+
+/** Appends printf output to a line. */
+static void appendLine(ANC150LogLine *pLine, const char *format, ...)
+{
+  size_t room = sizeof(pLine->text) - pLine->length;
+  va_list args;
+  int n;
+
+  va_start(args, format);
+  n = epicsVsnprintf(&pLine->text[pLine->length], room, format, args);
+  va_end(args);
+  if (n > 0)
+    pLine->length += ((size_t) n < room) ? (size_t) n : room - 1;
+}
+
+/** Appends the text of a format, with "%%" as "%". */
+static void appendText(ANC150LogLine *pLine, const char *text, size_t length)
+{
+  size_t i;
+
+  for (i=0; i<length && pLine->length < sizeof(pLine->text) - 1; i++) {
+    pLine->text[pLine->length++] = text[i];
+    if (text[i] == '%' && i + 1 < length && text[i + 1] == '%')
+      i++;
+  }
+  pLine->text[pLine->length] = 0;
+}
+
+/** Formats a record; conversions past the logged arguments are written as text. */
+static void formatRecord(const ANC150LogRecord *pRecord, ANC150LogLine *pLine)
+{
+  char spec[32], time[40];
+  const char *p, *from;
+  size_t length;
+  int i = 0;
+
+  pLine->length = 0;
+  pLine->text[0] = 0;
+  if (pRecord->infoMask & ASYN_TRACEINFO_TIME) {
+    epicsTimeToStrftime(time, sizeof(time), "%Y/%m/%d %H:%M:%S.%03f", &pRecord->time);
+    appendLine(pLine, "%s ", time);
+  }
+  if (pRecord->infoMask & ASYN_TRACEINFO_PORT) {
+    if (pRecord->axis >= 0)
+      appendLine(pLine, "%s axis %d ", pRecord->portName, pRecord->axis);
+    else
+      appendLine(pLine, "%s ", pRecord->portName);
+  }
+  if (pRecord->infoMask & ASYN_TRACEINFO_THREAD)
+    appendLine(pLine, "[%s] ", pRecord->thread);
+
+  for (from = pRecord->format; (p = nextConversion(from, &length)) && i < pRecord->nArgs; from = p + length) {
+    appendText(pLine, from, p - from);
+    if (length > sizeof(spec) - 2)
+      length = sizeof(spec) - 2;
+    memcpy(spec, p, length);
+    spec[length] = 0;
+    switch (pRecord->types[i]) {
+    case 'f': case 'e': case 'E': case 'g': case 'G':
+      appendLine(pLine, spec, pRecord->args[i].d);
+      break;
+    case 's':
+      appendLine(pLine, spec, &pRecord->text[pRecord->args[i].offset]);
+      break;
+    case 'p':
+      appendLine(pLine, spec, pRecord->args[i].p);
+      break;
+    case 'c':
+      appendLine(pLine, spec, (int) pRecord->args[i].l);
+      break;
+    default:
+      /* Integer conversions are written as long; h and hh as int. */
+      switch (lengthModifier(spec, length)) {
+      case 'h':
+        appendLine(pLine, spec, (int) pRecord->args[i].l);
+        break;
+      case 'l':
+        appendLine(pLine, spec, pRecord->args[i].l);
+        break;
+      default:
+        spec[length + 1] = 0;
+        spec[length] = spec[length - 1];
+        spec[length - 1] = 'l';
+        appendLine(pLine, spec, pRecord->args[i].l);
+        break;
+      }
+      break;
+    }
+    i++;
+  }
+  appendText(pLine, from, strlen(from));
+}
+
+/** Formats the records in the ring and writes each to the trace file of its
+  * asynUser.  Called by the log thread only. */
+void ANC150LogFlush()
+{
+  ANC150LogRecord *pRecord;
+  ANC150LogLine line;
+  FILE *fp;
+
+  while (true) {
+    pRecord = &records[tail & (ANC150_LOG_RECORDS - 1)];
+    if (epicsAtomicGetSizeT(&pRecord->sequence) != tail + 1)
+      break;
+    epicsAtomicReadMemoryBarrier();
+    formatRecord(pRecord, &line);
+    pasynTrace->lock(pRecord->pasynUser);
+    fp = pasynTrace->getTraceFile(pRecord->pasynUser);
+    if (fp) {
+      fputs(line.text, fp);
+      fflush(fp);
+    }
+    else
+      errlogPrintf("%s", line.text);
+    pasynTrace->unlock(pRecord->pasynUser);
+    epicsAtomicSetSizeT(&pRecord->sequence, tail + ANC150_LOG_RECORDS);
+    tail++;
+  }
+}
+
+static void logThread(void *pPvt)
+{
+  while (true) {
+    ANC150LogFlush();
+    epicsThreadSleep(ANC150_LOG_FLUSH_PERIOD);
+  }
+}
+
+/** Sets the runtime mask of the ANC150 trace log and prints its counters.
+  * Called directly or from iocsh
+  * \param[in] mask asyn trace bits that are logged, also when the port's trace mask enables them; -1 for all,
+  *                 the default
+  */
+extern "C" int ANC150LogMask(int mask)
+{
+  epicsAtomicSetIntT(&logMask, mask);
+  printf("ANC150 log: mask=0x%x, %lu records logged, %lu dropped\n", (unsigned) mask,
+         (unsigned long) epicsAtomicGetSizeT(&logged), (unsigned long) epicsAtomicGetSizeT(&dropped));
+  return(0);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150LogMaskArg0 = {"Mask", iocshArgInt};
+static const iocshArg * const ANC150LogMaskArgs[] = {&ANC150LogMaskArg0};
+static const iocshFuncDef ANC150LogMaskDef = {"ANC150LogMask", 1, ANC150LogMaskArgs};
+static void ANC150LogMaskCallFunc(const iocshArgBuf *args)
+{
+  ANC150LogMask(args[0].ival);
+}
+
+static void ANC150LogRegister(void)
+{
+  iocshRegister(&ANC150LogMaskDef, ANC150LogMaskCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150LogRegister);
+}
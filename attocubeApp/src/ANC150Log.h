@@ -0,0 +1,54 @@
+/*
+FILENAME...     ANC150Log.h
+USAGE...        Asynchronous trace log of the attocube systems AG ANC150 driver.
+
+*/
+
+#ifndef ANC150Log_H
+#define ANC150Log_H
+
+#include <stddef.h>
+
+#include "epicsTime.h"
+#include "asynDriver.h"
+
+#define ANC150_LOG_RECORDS 1024     /* Records in the ring; a power of 2 */
+#define ANC150_LOG_MAX_ARGS 6       /* Conversions of a format that are logged */
+#define ANC150_LOG_TEXT_SIZE 64     /* Room for the %s arguments of a record */
+#define ANC150_LOG_THREAD_SIZE 16   /* Room for the name of the logging thread */
+#define ANC150_LOG_LINE_SIZE 256    /* Longest formatted record */
+#define ANC150_LOG_FLUSH_PERIOD 0.02 /* Time between drains of the ring (sec) */
+
+/** An argument of a log record; the type is the conversion character. */
+typedef union ANC150LogArg {
+  long l;
+  double d;
+  const void *p;
+  int offset;                 /* Of a %s argument in ANC150LogRecord.text. */
+} ANC150LogArg;
+
+/** A log record: the format and its arguments, formatted by the log thread. */
+typedef struct ANC150LogRecord {
+  size_t sequence;            /* Ring position the slot is ready for; see ANC150Log.cpp. */
+  epicsTimeStamp time;
+  const char *portName;       /* Must outlive the record, as must format. */
+  const char *format;
+  asynUser *pasynUser;        /* Selects the trace file; must outlive the record. */
+  int infoMask;               /* asyn trace info mask when the record was logged. */
+  int axis;                   /* -1 for the controller. */
+  int mask;
+  int nArgs;
+  char types[ANC150_LOG_MAX_ARGS];
+  ANC150LogArg args[ANC150_LOG_MAX_ARGS];
+  char text[ANC150_LOG_TEXT_SIZE];
+  char thread[ANC150_LOG_THREAD_SIZE]; /* Set if infoMask has ASYN_TRACEINFO_THREAD. */
+} ANC150LogRecord;
+
+bool ANC150LogPrint(asynUser *pasynUser, const char *portName, int axis, int mask, const char *format, ...)
+#if defined(__GNUC__)
+  __attribute__((format(printf, 5, 6)))
+#endif
+  ;
+void ANC150LogFlush();
+
+#endif /* ANC150Log_H */
@@ -0,0 +1,193 @@
+/*
+FILENAME...     ANC150Mailbox.cpp
+USAGE...        Latest-wins move mailbox for the attocube systems AG ANC150
+                motor driver.
+
+*/
+
+/*
+ * By default ANC150Axis::move() sends its step command before it returns, so a
+ * motor record written many times a second queues one serial transaction per
+ * write.  ANC150CreateMailbox(portName),
+ * called after ANC150CreateController(), makes move() post the move instead:
+ * it is recorded exactly like a deferred move (deferredMove_, deferredSteps_)
+ * and a dispatcher thread sends it.  A move posted before the previous one of
+ * the same axis was sent replaces it; relative moves add up.  stop() drops a
+ * pending move and is sent at once, as before.
+ *
+ * The dispatcher takes every pending move of the controller in one burst,
+ * starts their simulated trajectories and sends them with the controller lock
+ * released, so moves posted meanwhile wait in the mailbox instead of behind
+ * the serial link.  It holds ioLock_ from the time it takes the moves until
+ * they are sent, so a stop() issued after a move was taken is still sent after
+ * it.  Closed-loop (approach) moves are not posted.
+ *
+ * The moves replaced before they were sent and those dropped by stop() are
+ * counted as ANC150_COALESCED and ANC150_PREEMPTED.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
+#include <epicsStdio.h>
+#include <epicsExit.h>
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include "ANC150Log.h"
+#include <epicsExport.h>
+
+static void ANC150DispatcherC(void *pPvt)
+{
+  ANC150Controller *pC = (ANC150Controller *) pPvt;
+  pC->dispatcherThread();
+}
+
+static void ANC150MailboxExitC(void *pPvt)
+{
+  ANC150Controller *pC = (ANC150Controller *) pPvt;
+  pC->shutdownMailbox();
+}
+
+/** Starts the dispatcher thread; from then on moves are posted to the mailbox.
+  * Called with the controller lock held. */
+asynStatus ANC150Controller::createMailbox()
+{
+  char name[64];
+
+  if (mailboxEvent_)
+    return asynSuccess;
+  mailboxEvent_ = epicsEventMustCreate(epicsEventEmpty);
+  epicsSnprintf(name, sizeof(name), "ANC150Dispatch:%s", portName);
+  epicsThreadCreate(name, epicsThreadPriorityMedium,
+                    epicsThreadGetStackSize(epicsThreadStackMedium),
+                    (EPICSTHREADFUNC) ANC150DispatcherC, this);
+  epicsAtExit(ANC150MailboxExitC, this);
+  return asynSuccess;
+}
+
+/** Body of the dispatcher thread; returns once the IOC is shutting down. */
+void ANC150Controller::dispatcherThread()
+{
+  for (;;) {
+    epicsEventWait(mailboxEvent_);
+    lock();
+    if (shuttingDown_) {
+      unlock();
+      return;
+    }
+    unlock();
+    dispatchMoves();
+  }
+}
+
+/** Wakes the dispatcher thread so that it exits.  Called at IOC exit, which
+  * may be before the base class marks the controller as shutting down. */
+void ANC150Controller::shutdownMailbox()
+{
+  lock();
+  shuttingDown_ = 1;
+  unlock();
+  epicsEventSignal(mailboxEvent_);
+}
+
+/** Sends the newest pending move of every axis in one burst.
+  * Called without the controller lock held. */
+void ANC150Controller::dispatchMoves()
+{
+  ANC150Command cmds[2 * ANC150_MAX_AXES];
+  ANC150Axis *pAxes[2 * ANC150_MAX_AXES];
+  unsigned int generation[2 * ANC150_MAX_AXES];
+  ANC150Axis *pAxis;
+  epicsTime start;
+  int nCmds, nFrequencies, nFailed = 0;
+  int i;
+
+  lock();
+  /* A group of deferred moves is sent by setDeferredMoves(false). */
+  if (movesDeferred_) {
+    unlock();
+    return;
+  }
+  nCmds = formatDeferredMoves(cmds, pAxes, &nFrequencies);
+  if (nCmds == 0) {
+    unlock();
+    return;
+  }
+  start = epicsTime::getCurrent();
+  for (i=nFrequencies; i<nCmds; i++) {
+    pAxis = pAxes[i];
+    generation[i] = pAxis->moveGeneration_;
+    pAxis->startTimer(pAxis->deferredSteps_, start);
+  }
+  /* Keep stop() and every other transaction behind these commands. */
+  epicsMutexLock(ioLock_);
+  unlock();
+
+  sendCommands(cmds, nCmds);
+  epicsMutexUnlock(ioLock_);
+
+  lock();
+  for (i=0; i<nFrequencies; i++)
+    pAxes[i]->frequencySent(&cmds[i]);
+  for (i=nFrequencies; i<nCmds; i++) {
+    pAxis = pAxes[i];
+    if (cmds[i].status == asynSuccess) {
+      pAxis->journal();
+      continue;
+    }
+    nFailed++;
+    /* The axis did not start; unless it was given a newer move or stopped
+     * meanwhile, report it done where it is. */
+    if (pAxis->moveGeneration_ == generation[i]) {
+      pAxis->moving_ = false;
+      pAxis->targetPosition_ = pAxis->currentPosition_;
+    }
+  }
+  unlock();
+  ANC150LogPrint(pasynUserSelf, portName, -1, ASYN_TRACE_FLOW,
+                 "ANC150Controller::dispatchMoves: %d moves sent, %d failed, %d frequencies set\n",
+                 nCmds - nFrequencies, nFailed, nFrequencies);
+  wakeupPoller();
+}
+
+/** Makes the moves of a controller go through a latest-wins mailbox.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName The asyn port name given to ANC150CreateController
+  */
+extern "C" int ANC150CreateMailbox(const char *portName)
+{
+  ANC150Controller *pC;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150CreateMailbox: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  pC->lock();
+  pC->createMailbox();
+  pC->unlock();
+  return(asynSuccess);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150CreateMailboxArg0 = {"Port name", iocshArgString};
+static const iocshArg * const ANC150CreateMailboxArgs[] = {&ANC150CreateMailboxArg0};
+static const iocshFuncDef ANC150CreateMailboxDef = {"ANC150CreateMailbox", 1, ANC150CreateMailboxArgs};
+static void ANC150CreateMailboxCallFunc(const iocshArgBuf *args)
+{
+  ANC150CreateMailbox(args[0].sval);
+}
+
+static void ANC150MailboxRegister(void)
+{
+  iocshRegister(&ANC150CreateMailboxDef, ANC150CreateMailboxCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150MailboxRegister);
+}
@@ -0,0 +1,207 @@
+/*
+FILENAME...     ANC150Parser.cpp
+USAGE...        Protocol traits, reply framing and parsing for the attocube
+                systems AG ANC150 and ANC300 Piezo Step Controllers.
+
+*/
+
+/*
+ * The ANC150 echoes every command, then sends a reply line, an acknowledge
+ * line and the "> " prompt.  ANC150ParseFrame() splits a frame in one pass and
+ * returns views into the receive buffer; ANC150ParseReply() decodes the reply
+ * line according to the command table.  Neither copies nor allocates, except
+ * for commands whose reply is text (ver).
+ *
+ * The ANC300, reached over TCP (telnet port 7230), speaks the same command set
+ * with the same framing, except that commands without a reply send no reply
+ * line, integer replies carry a unit ("frequency = 1000 Hz"), the reply to
+ * "ver" spans several lines and every connection starts with the
+ * authorization code.  The frame parser and the reply decoder accept both;
+ * the remaining differences are the per-model protocol traits below.
+ */
+
+#include <string.h>
+#include <limits.h>
+
+#include "ANC150Parser.h"
+
+static const char notInControl[] = "Axis not in computer control mode";
+
+/* Protocol traits of the supported models. */
+const ANC150Protocol ANC150ProtocolANC150 = {
+  "ANC150", 6, 1, 8000, "\r\n", "> ", "attocube", 19, NULL, 2.0, true, ""
+};
+const ANC150Protocol ANC150ProtocolANC300 = {
+  "ANC300", 7, 1, 10000, "\r\n", "> ", "attocube ANC300", 35, "123456", 1.0, false, " Hz"
+};
+
+static const ANC150Protocol *protocolTable[] = {&ANC150ProtocolANC150, &ANC150ProtocolANC300};
+#define NUM_PROTOCOLS ((int)(sizeof(protocolTable) / sizeof(protocolTable[0])))
+
+/* The command table; the first word of every command the driver sends. */
+static const ANC150CommandDef commandTable[] = {
+  {"ver",   ANC150CmdQuery, ANC150ReplyText, "",             ANC150TimeoutLong},
+  {"getf",  ANC150CmdQuery, ANC150ReplyInt,  "frequency = ", ANC150TimeoutShort},
+  {"getm",  ANC150CmdQuery, ANC150ReplyMode, "mode = ",      ANC150TimeoutShort},
+  {"setf",  ANC150CmdSet,   ANC150ReplyNone, "",             ANC150TimeoutShort},
+  {"setm",  ANC150CmdSet,   ANC150ReplyNone, "",             ANC150TimeoutShort},
+  {"stepu", ANC150CmdMove,  ANC150ReplyNone, "",             ANC150TimeoutShort},
+  {"stepd", ANC150CmdMove,  ANC150ReplyNone, "",             ANC150TimeoutShort},
+  {"stop",  ANC150CmdStop,  ANC150ReplyNone, "",             ANC150TimeoutShort},
+};
+#define NUM_COMMANDS ((int)(sizeof(commandTable) / sizeof(commandTable[0])))
+
+/** Looks up a command in the command table.
+  * \param[in] command The command string; only its first word is used.
+  * \return The table entry, or NULL if the command is unknown. */
+const ANC150CommandDef *ANC150FindCommand(const char *command)
+{
+  size_t len = strcspn(command, " ");
+  int i;
+
+  for (i=0; i<NUM_COMMANDS; i++) {
+    if (strlen(commandTable[i].name) == len && memcmp(commandTable[i].name, command, len) == 0)
+      return(&commandTable[i]);
+  }
+  return(NULL);
+}
+
+/** Looks up the protocol traits of a controller model.
+  * \param[in] model The model name, e.g. "ANC300".
+  * \return The traits, or NULL if the model is unknown. */
+const ANC150Protocol *ANC150FindProtocol(const char *model)
+{
+  int i;
+
+  for (i=0; model && i<NUM_PROTOCOLS; i++) {
+    if (strcmp(protocolTable[i]->model, model) == 0)
+      return(protocolTable[i]);
+  }
+  return(NULL);
+}
+
+/** Splits a reply frame into views in a single pass.
+  * The first line is the echo and the last the acknowledge; the reply is the
+  * second line of a frame of three or more lines (further lines of a
+  * multi-line reply are ignored) and empty in a frame of two.
+  * \param[in] buffer The receive buffer; need not be NUL terminated.
+  * \param[in] len The number of bytes in buffer.
+  * \param[out] pFrame Views of the echo, reply and acknowledge lines.
+  * \return The number of bytes up to and including the last "\r\n", or 0 if the frame has fewer than two lines. */
+size_t ANC150ParseFrame(const char *buffer, size_t len, ANC150Frame *pFrame)
+{
+  size_t start = 0;
+  size_t i;
+  int nLines = 0;
+
+  for (i=0; i+1<len; i++) {
+    if (buffer[i] == '\r' && buffer[i+1] == '\n') {
+      if (nLines == 0) {
+        pFrame->echo.ptr = &buffer[start];
+        pFrame->echo.len = i - start;
+      }
+      else if (nLines == 1) {
+        pFrame->reply.ptr = &buffer[start];
+        pFrame->reply.len = i - start;
+      }
+      pFrame->ack.ptr = &buffer[start];
+      pFrame->ack.len = i - start;
+      nLines++;
+      start = ++i + 1;
+    }
+  }
+  if (nLines < 2)
+    return(0);
+  if (nLines == 2)
+    pFrame->reply.len = 0;
+  return(start);
+}
+
+/** Compares a view with a NUL terminated string. */
+bool ANC150ViewEquals(const ANC150View *pView, const char *str)
+{
+  size_t len = strlen(str);
+
+  return(pView->len == len && memcmp(pView->ptr, str, len) == 0);
+}
+
+/** Decodes the reply line of a frame.
+  * \param[in] pDef The command table entry of the command; NULL decodes as ANC150ReplyNone.
+  * \param[in] pFrame The frame split by ANC150ParseFrame().
+  * \param[out] pResult The decoded reply. */
+void ANC150ParseReply(const ANC150CommandDef *pDef, const ANC150Frame *pFrame, ANC150Result *pResult)
+{
+  const char *p, *end;
+  size_t prefixLen;
+  bool negative = false;
+  int value = 0;
+
+  pResult->value = 0;
+  pResult->text[0] = 0;
+
+  if (ANC150ViewEquals(&pFrame->reply, notInControl)) {
+    pResult->code = ANC150ResultNotInControl;
+    return;
+  }
+  if (ANC150ViewEquals(&pFrame->ack, "ERROR")) {
+    pResult->code = ANC150ResultError;
+    return;
+  }
+  pResult->code = ANC150ResultOK;
+  if (!pDef)
+    return;
+
+  prefixLen = strlen(pDef->prefix);
+  if (pFrame->reply.len < prefixLen || memcmp(pFrame->reply.ptr, pDef->prefix, prefixLen) != 0) {
+    pResult->code = ANC150ResultBadReply;
+    return;
+  }
+  p = pFrame->reply.ptr + prefixLen;
+  end = pFrame->reply.ptr + pFrame->reply.len;
+
+  switch (pDef->replyType) {
+  case ANC150ReplyNone:
+    break;
+
+  case ANC150ReplyInt:
+    if (p < end && (*p == '-' || *p == '+'))
+      negative = (*p++ == '-');
+    if (p == end || *p < '0' || *p > '9')
+      pResult->code = ANC150ResultBadReply;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+      /* Values that do not fit in an int are bad replies. */
+      if (value > (INT_MAX - (*p - '0')) / 10) {
+        pResult->code = ANC150ResultBadReply;
+        value = 0;
+        p = end;
+        break;
+      }
+      value = value * 10 + (*p - '0');
+    }
+    /* A unit (ANC300) is a space and letters after the integer. */
+    if (p < end && *p == ' ' && p + 1 < end) {
+      for (p++; p < end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')); p++)
+        ;
+    }
+    if (p != end)
+      pResult->code = ANC150ResultBadReply;
+    pResult->value = negative ? -value : value;
+    break;
+
+  case ANC150ReplyMode:
+    if (end - p == 3 && memcmp(p, "stp", 3) == 0)
+      pResult->value = 1;
+    else if (end - p == 3 && memcmp(p, "gnd", 3) == 0)
+      pResult->value = 0;
+    else
+      pResult->code = ANC150ResultBadReply;
+    break;
+
+  case ANC150ReplyText:
+    if ((size_t) (end - p) >= sizeof(pResult->text))
+      end = p + sizeof(pResult->text) - 1;
+    memcpy(pResult->text, p, end - p);
+    pResult->text[end - p] = 0;
+    break;
+  }
+}
@@ -0,0 +1,103 @@
+/*
+FILENAME...     ANC150Parser.h
+USAGE...        Protocol traits, reply framing and parsing for the attocube
+                systems AG ANC150 and ANC300 Piezo Step Controllers.
+
+*/
+
+#ifndef ANC150Parser_H
+#define ANC150Parser_H
+
+#include <stddef.h>
+
+#define ANC150_TEXT_SIZE 100        /* Size of a copied text reply */
+
+/* Command classes, used for the latency histograms. */
+typedef enum {
+  ANC150CmdQuery,             /* ver, getf, getm */
+  ANC150CmdSet,               /* setf, setm */
+  ANC150CmdMove,              /* stepu, stepd */
+  ANC150CmdStop,              /* stop */
+  ANC150NumCmdClasses
+} ANC150CmdClass;
+
+/* Timeout classes; each has its own adaptive timeout (ANC150Timeout.cpp). */
+typedef enum {
+  ANC150TimeoutShort,
+  ANC150TimeoutLong,          /* ver */
+  ANC150NumTimeoutClasses
+} ANC150TimeoutClass;
+
+/* How the reply line of a command is decoded. */
+typedef enum {
+  ANC150ReplyNone,            /* Reply line is ignored. */
+  ANC150ReplyInt,             /* "<prefix><integer>[ <unit>]" */
+  ANC150ReplyMode,            /* "<prefix>stp" or "<prefix>gnd" */
+  ANC150ReplyText             /* Reply line is copied. */
+} ANC150ReplyType;
+
+/** Protocol traits of a controller model.  The command set and the framing
+  * ("<echo>\r\n[<reply>\r\n]<ack>\r\n> ") are shared by the ANC150 and the
+  * ANC300; these are the differences. */
+typedef struct ANC150Protocol {
+  const char *model;          /* Model name, e.g. "ANC300". */
+  int maxAxes;                /* Axes (ANC300: modules) per controller. */
+  int minFrequency;           /* Step frequency range of "setf" (Hz). */
+  int maxFrequency;
+  const char *outEos;         /* Command terminator. */
+  const char *inEos;          /* Prompt that ends every reply. */
+  const char *versionPrefix;  /* Start of the reply to "ver". */
+  size_t firmwareOffset;      /* Offset of the firmware version in the reply to "ver". */
+  const char *login;          /* Sent before "ver" on every connection; NULL if none. */
+  double maxTimeout;          /* Default longest I/O timeout (sec). */
+  bool emptyReply;            /* Commands without a reply send an empty reply line. */
+  const char *frequencyUnit;  /* Unit after the value in the reply to "getf"; "" if none. */
+} ANC150Protocol;
+
+extern const ANC150Protocol ANC150ProtocolANC150;
+extern const ANC150Protocol ANC150ProtocolANC300;
+
+/** Entry of the command table. */
+typedef struct ANC150CommandDef {
+  const char *name;           /* Command name, the first word of the command. */
+  ANC150CmdClass cmdClass;
+  ANC150ReplyType replyType;
+  const char *prefix;         /* Expected start of the reply line. */
+  ANC150TimeoutClass timeoutClass;
+} ANC150CommandDef;
+
+/** A view into a receive buffer; not NUL terminated. */
+typedef struct ANC150View {
+  const char *ptr;
+  size_t len;
+} ANC150View;
+
+/** A reply frame "<echo>\r\n<reply>\r\n<ack>\r\n" split into views; the
+  * reply view is empty if the frame has no reply line. */
+typedef struct ANC150Frame {
+  ANC150View echo;
+  ANC150View reply;
+  ANC150View ack;
+} ANC150Frame;
+
+typedef enum {
+  ANC150ResultOK,             /* Reply decoded. */
+  ANC150ResultNotInControl,   /* "Axis not in computer control mode" */
+  ANC150ResultError,          /* Any other reply acknowledged with "ERROR". */
+  ANC150ResultBadReply        /* Reply line does not match the command table. */
+} ANC150ResultCode;
+
+/** Decoded reply of a command. */
+typedef struct ANC150Result {
+  ANC150ResultCode code;
+  int value;                  /* ANC150ReplyInt: the integer; ANC150ReplyMode: 1 for stp, 0 for gnd. */
+  char text[ANC150_TEXT_SIZE]; /* ANC150ReplyText only. */
+} ANC150Result;
+
+const ANC150Protocol *ANC150FindProtocol(const char *model);
+const ANC150CommandDef *ANC150FindCommand(const char *command);
+size_t ANC150ParseFrame(const char *buffer, size_t len, ANC150Frame *pFrame);
+bool ANC150ViewEquals(const ANC150View *pView, const char *str);
+void ANC150ParseReply(const ANC150CommandDef *pDef, const ANC150Frame *pFrame, ANC150Result *pResult);
+
+#endif /* ANC150Parser_H */
@@ -0,0 +1,223 @@
+/*
+FILENAME...     ANC150PollerPool.cpp
+USAGE...        Shared poller threads for attocube systems AG ANC150 controllers.
+
+*/
+
+/*
+ * By default every ANC150Controller has its own poller thread.  On an IOC with
+ * many controllers, ANC150CreatePollerPool(nWorkers), called before the
+ * controllers are created, makes them share a small number of worker threads
+ * instead.  Each controller has one entry in a queue ordered by the deadline
+ * of its next poller step (ANC150Controller::pollerStep()); a worker takes the
+ * earliest entry once it is due, makes the step and puts the entry back at
+ * the deadline the step returns, so every controller keeps its own moving,
+ * idle and publish cadence.  An entry is out of the queue while its step
+ * runs, so a controller is never polled by two workers at once.
+ * wakeupPoller() moves the controller's entry to the head of the queue.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsThread.h>
+#include <epicsStdio.h>
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include "ANC150PollerPool.h"
+#include <epicsExport.h>
+
+ANC150PollerPool *ANC150PollerPool::defaultPool = NULL;
+
+static void ANC150PoolWorkerC(void *pPvt)
+{
+  ANC150PollerPool *pPool = (ANC150PollerPool *) pPvt;
+  pPool->worker();
+}
+
+/** Creates a pool and starts its worker threads.
+  * \param[in] nWorkers The number of worker threads. */
+ANC150PollerPool::ANC150PollerPool(int nWorkers)
+  : nWorkers_(nWorkers), nControllers_(0), pQueue_(NULL), pEntries_(NULL),
+    steps_(0), latenessSum_(0.0), latenessMax_(0.0)
+{
+  char name[32];
+  int i;
+
+  lock_ = epicsMutexMustCreate();
+  event_ = epicsEventMustCreate(epicsEventEmpty);
+  for (i=0; i<nWorkers_; i++) {
+    epicsSnprintf(name, sizeof(name), "ANC150Pool%d", i);
+    epicsThreadCreate(name, epicsThreadPriorityMedium,
+                      epicsThreadGetStackSize(epicsThreadStackMedium),
+                      (EPICSTHREADFUNC) ANC150PoolWorkerC, this);
+  }
+}
+
+/** Adds a controller to the pool; its first step is due at once.
+  * \param[in] pC The controller.
+  * \return The controller's entry, passed to wakeup(). */
+ANC150PollerEntry *ANC150PollerPool::add(ANC150Controller *pC)
+{
+  ANC150PollerEntry *pEntry;
+
+  pEntry = new ANC150PollerEntry();
+  pEntry->pC = pC;
+  epicsMutexLock(lock_);
+  pEntry->pNextEntry = pEntries_;
+  pEntries_ = pEntry;
+  nControllers_++;
+  schedule(pEntry, epicsTime::getCurrent());
+  epicsMutexUnlock(lock_);
+  return(pEntry);
+}
+
+/** Inserts an entry in the queue in deadline order.  Called with lock_ held.
+  * \param[in] pEntry The entry; not queued.
+  * \param[in] deadline The time of its next step. */
+void ANC150PollerPool::schedule(ANC150PollerEntry *pEntry, const epicsTime &deadline)
+{
+  ANC150PollerEntry **ppNext;
+
+  pEntry->deadline = deadline;
+  for (ppNext = &pQueue_; *ppNext && (*ppNext)->deadline <= deadline; ppNext = &(*ppNext)->pNext)
+    ;
+  pEntry->pNext = *ppNext;
+  *ppNext = pEntry;
+  pEntry->queued = true;
+  if (pQueue_ == pEntry)
+    epicsEventSignal(event_);
+}
+
+/** Removes an entry from the queue.  Called with lock_ held. */
+void ANC150PollerPool::unqueue(ANC150PollerEntry *pEntry)
+{
+  ANC150PollerEntry **ppNext;
+
+  for (ppNext = &pQueue_; *ppNext && *ppNext != pEntry; ppNext = &(*ppNext)->pNext)
+    ;
+  if (*ppNext)
+    *ppNext = pEntry->pNext;
+  pEntry->queued = false;
+}
+
+/** Makes a controller's next step due at once; replaces asynMotorController::wakeupPoller().
+  * \param[in] pEntry The controller's entry. */
+void ANC150PollerPool::wakeup(ANC150PollerEntry *pEntry)
+{
+  epicsMutexLock(lock_);
+  pEntry->woken = true;
+  /* A running step is rescheduled by its worker when it ends. */
+  if (!pEntry->running) {
+    if (pEntry->queued)
+      unqueue(pEntry);
+    schedule(pEntry, epicsTime::getCurrent());
+  }
+  epicsMutexUnlock(lock_);
+}
+
+/** Body of a worker thread. */
+void ANC150PollerPool::worker()
+{
+  ANC150PollerEntry *pEntry;
+  epicsTime now, deadline;
+  double lateness;
+  bool woken, haveDeadline, alive;
+
+  epicsMutexLock(lock_);
+  while (true) {
+    now = epicsTime::getCurrent();
+    if (!pQueue_ || pQueue_->deadline > now) {
+      deadline = pQueue_ ? pQueue_->deadline : now;
+      haveDeadline = (pQueue_ != NULL);
+      epicsMutexUnlock(lock_);
+      if (haveDeadline)
+        epicsEventWaitWithTimeout(event_, deadline - now);
+      else
+        epicsEventWait(event_);
+      epicsMutexLock(lock_);
+      continue;
+    }
+
+    pEntry = pQueue_;
+    pQueue_ = pEntry->pNext;
+    pEntry->queued = false;
+    pEntry->running = true;
+    woken = pEntry->woken;
+    pEntry->woken = false;
+    lateness = now - pEntry->deadline;
+    steps_++;
+    latenessSum_ += lateness;
+    if (lateness > latenessMax_)
+      latenessMax_ = lateness;
+    /* Let another worker take the next entry if it is due too. */
+    if (pQueue_ && pQueue_->deadline <= now)
+      epicsEventSignal(event_);
+    epicsMutexUnlock(lock_);
+
+    alive = pEntry->pC->pollerStep(woken, &deadline, &haveDeadline);
+
+    epicsMutexLock(lock_);
+    pEntry->running = false;
+    if (!alive)
+      continue;
+    if (pEntry->woken)
+      schedule(pEntry, epicsTime::getCurrent());
+    else if (haveDeadline)
+      schedule(pEntry, deadline);
+  }
+}
+
+/** Clears the lateness statistics. */
+void ANC150PollerPool::resetStats()
+{
+  epicsMutexLock(lock_);
+  steps_ = 0;
+  latenessSum_ = latenessMax_ = 0.0;
+  epicsMutexUnlock(lock_);
+}
+
+void ANC150PollerPool::report(FILE *fp)
+{
+  epicsMutexLock(lock_);
+  fprintf(fp, "    poller pool: %d workers, %d controllers, %ld steps, lateness mean=%f max=%f\n",
+          nWorkers_, nControllers_, steps_, steps_ ? latenessSum_ / steps_ : 0.0, latenessMax_);
+  epicsMutexUnlock(lock_);
+}
+
+/** Creates the poller pool shared by all ANC150 controllers created after it.
+  * Configuration command, called directly or from iocsh
+  * \param[in] nWorkers The number of worker threads
+  */
+extern "C" int ANC150CreatePollerPool(int nWorkers)
+{
+  if (ANC150PollerPool::defaultPool) {
+    printf("ANC150CreatePollerPool: the poller pool already exists\n");
+    return(asynError);
+  }
+  if (nWorkers < 1) {
+    printf("ANC150CreatePollerPool: nWorkers must be at least 1\n");
+    return(asynError);
+  }
+  ANC150PollerPool::defaultPool = new ANC150PollerPool(nWorkers);
+  return(asynSuccess);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150CreatePollerPoolArg0 = {"Number of workers", iocshArgInt};
+static const iocshArg * const ANC150CreatePollerPoolArgs[] = {&ANC150CreatePollerPoolArg0};
+static const iocshFuncDef ANC150CreatePollerPoolDef = {"ANC150CreatePollerPool", 1, ANC150CreatePollerPoolArgs};
+static void ANC150CreatePollerPoolCallFunc(const iocshArgBuf *args)
+{
+  ANC150CreatePollerPool(args[0].ival);
+}
+
+static void ANC150PollerPoolRegister(void)
+{
+  iocshRegister(&ANC150CreatePollerPoolDef, ANC150CreatePollerPoolCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150PollerPoolRegister);
+}
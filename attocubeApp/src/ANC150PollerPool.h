@@ -0,0 +1,59 @@
+/*
+FILENAME...     ANC150PollerPool.h
+USAGE...        Shared poller threads for attocube systems AG ANC150 controllers.
+
+*/
+
+#ifndef ANC150PollerPool_H
+#define ANC150PollerPool_H
+
+#include <stdio.h>
+
+#include "epicsTime.h"
+#include "epicsMutex.h"
+#include "epicsEvent.h"
+
+class ANC150Controller;
+
+/** A controller served by a poller pool. */
+typedef struct ANC150PollerEntry {
+  ANC150Controller *pC;
+  epicsTime deadline;         /* Time of the controller's next poller step. */
+  bool queued;                /* In the deadline queue. */
+  bool running;               /* A worker is making the controller's poller step. */
+  bool woken;                 /* wakeupPoller() was called since the last step started. */
+  struct ANC150PollerEntry *pNext; /* Next entry in the queue, or in the list of all entries. */
+  struct ANC150PollerEntry *pNextEntry;
+} ANC150PollerEntry;
+
+class ANC150PollerPool {
+public:
+  ANC150PollerPool(int nWorkers);
+  ANC150PollerEntry *add(ANC150Controller *pC);
+  void wakeup(ANC150PollerEntry *pEntry);
+  void worker();
+  void report(FILE *fp);
+  void resetStats();
+  int numWorkers() { return nWorkers_; }
+  int numControllers() { return nControllers_; }
+  double meanLateness() { return steps_ ? latenessSum_ / steps_ : 0.0; }
+  double maxLateness() { return latenessMax_; }
+
+  static ANC150PollerPool *defaultPool; /* Used by controllers created after ANC150CreatePollerPool(). */
+
+private:
+  void schedule(ANC150PollerEntry *pEntry, const epicsTime &deadline);
+  void unqueue(ANC150PollerEntry *pEntry);
+
+  int nWorkers_;
+  int nControllers_;
+  epicsMutexId lock_;         /* Protects the entries and the queue. */
+  epicsEventId event_;        /* Signalled when the head of the queue changes. */
+  ANC150PollerEntry *pQueue_; /* Queued entries, earliest deadline first. */
+  ANC150PollerEntry *pEntries_;
+  long steps_;                /* Poller steps made. */
+  double latenessSum_;        /* Sum and maximum of the delays from deadline to step (sec). */
+  double latenessMax_;
+};
+
+#endif /* ANC150PollerPool_H */
@@ -0,0 +1,393 @@
+/*
+FILENAME...     ANC150Profile.cpp
+USAGE...        Profile moves for the attocube systems AG ANC150 motor driver.
+
+*/
+
+/*
+ * The ANC150 has no trajectory support of its own, so a profile is streamed
+ * from the host: the move from each point to the next becomes one "stepu" or
+ * "stepd" burst per axis, sent by a high priority thread at an absolute
+ * deadline.  Element i of the time array is the duration of the move from
+ * point i to point i+1.  Point 0 is reached with an ordinary move and the
+ * schedule starts when the slowest axis gets there.
+ *
+ * The actual start of the move to each point, relative to the start of the
+ * schedule, is published as ANC150_PROFILE_START_TIMES and the largest delay
+ * past a deadline as ANC150_PROFILE_MAX_LATE.  The readbacks are the commanded
+ * positions; the ANC150 has no encoder.
+ *
+ * ANC150CreateProfile(portName, maxPoints) must be called after
+ * ANC150CreateController() to allocate the profile and start the thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include <epicsExport.h>
+
+#define NINT(f) (long)((f)>0 ? (f)+0.5 : (f)-0.5)       /* Nearest integer. */
+
+static void ANC150ProfileThreadC(void *pPvt)
+{
+  ANC150Controller *pC = (ANC150Controller *) pPvt;
+  pC->profileThread();
+}
+
+/** Allocates the profile arrays and starts the profile thread.  Called with the controller lock held.
+  * \param[in] maxProfilePoints Maximum number of profile points. */
+asynStatus ANC150Controller::initializeProfile(size_t maxProfilePoints)
+{
+  asynMotorController::initializeProfile(maxProfilePoints);
+
+  free(profileStartTimes_);
+  profileStartTimes_ = (double *) calloc(maxProfilePoints, sizeof(double));
+
+  if (!profileStartEvent_) {
+    profileStartEvent_ = epicsEventMustCreate(epicsEventEmpty);
+    profileAbortEvent_ = epicsEventMustCreate(epicsEventEmpty);
+    epicsThreadCreate("ANC150Profile", epicsThreadPriorityHigh,
+                      epicsThreadGetStackSize(epicsThreadStackMedium),
+                      (EPICSTHREADFUNC) ANC150ProfileThreadC, this);
+  }
+  return asynSuccess;
+}
+
+/** Checks that every axis can make each move of the profile in its time at its step frequency.
+  * Called with the controller lock held. */
+asynStatus ANC150Controller::buildProfile()
+{
+  ANC150Axis *pAxis;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  int buildStatus = PROFILE_STATUS_SUCCESS;
+  int numPoints, timeMode, useAxis, axis, point;
+  double fixedTime, duration, stepTime;
+
+  message[0] = 0;
+  setIntegerParam(profileBuildState_, PROFILE_BUILD_BUSY);
+  setIntegerParam(profileBuildStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks();
+
+  getIntegerParam(profileNumPoints_, &numPoints);
+  getIntegerParam(profileTimeMode_, &timeMode);
+  getDoubleParam(profileFixedTime_, &fixedTime);
+
+  if (!profileStartEvent_ || !profileTimes_) {
+    buildStatus = PROFILE_STATUS_FAILURE;
+    strcpy(message, "ANC150CreateProfile was not called");
+  } else if (numPoints < 2 || (size_t) numPoints > maxProfilePoints_) {
+    buildStatus = PROFILE_STATUS_FAILURE;
+    sprintf(message, "Number of points must be 2 to %d", (int) maxProfilePoints_);
+  }
+
+  for (axis=0; axis<numAxes_ && buildStatus == PROFILE_STATUS_SUCCESS; axis++) {
+    pAxis = getAxis(axis);
+    useAxis = 0;
+    getIntegerParam(axis, profileUseAxis_, &useAxis);
+    if (!pAxis || !useAxis) continue;
+    if (pAxis->frequency_ <= 0) {
+      buildStatus = PROFILE_STATUS_FAILURE;
+      sprintf(message, "Axis %d step frequency unknown", axis);
+      break;
+    }
+    for (point=1; point<numPoints; point++) {
+      duration = (timeMode == PROFILE_TIME_MODE_FIXED) ? fixedTime : profileTimes_[point - 1];
+      stepTime = labs(NINT(pAxis->profilePositions_[point]) - NINT(pAxis->profilePositions_[point - 1])) /
+                 (double) pAxis->frequency_;
+      if (stepTime > duration) {
+        buildStatus = PROFILE_STATUS_FAILURE;
+        sprintf(message, "Axis %d needs %.3f s to point %d, %.3f s allowed", axis, stepTime, point, duration);
+        break;
+      }
+    }
+  }
+
+  setIntegerParam(profileBuildState_, PROFILE_BUILD_DONE);
+  setIntegerParam(profileBuildStatus_, buildStatus);
+  setStringParam(profileBuildMessage_, message);
+  callParamCallbacks();
+  return (buildStatus == PROFILE_STATUS_SUCCESS) ? asynSuccess : asynError;
+}
+
+/** Starts a built profile on the profile thread.  Every profile axis must be
+  * idle: not jogging, approaching or moving, and without a deferred move.
+  * Called with the controller lock held. */
+asynStatus ANC150Controller::executeProfile()
+{
+  ANC150Axis *pAxis;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  int buildStatus, executeState, useAxis, axis;
+
+  getIntegerParam(profileBuildStatus_, &buildStatus);
+  getIntegerParam(profileExecuteState_, &executeState);
+  if (!profileStartEvent_ || buildStatus != PROFILE_STATUS_SUCCESS) {
+    setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+    setStringParam(profileExecuteMessage_, "Profile is not built");
+    callParamCallbacks();
+    return asynError;
+  }
+  if (!ready_) {
+    setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+    setStringParam(profileExecuteMessage_, "Controller is not ready");
+    callParamCallbacks();
+    return asynError;
+  }
+  if (executeState != PROFILE_EXECUTE_DONE) {
+    setStringParam(profileExecuteMessage_, "Profile is already executing");
+    callParamCallbacks();
+    return asynError;
+  }
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    useAxis = 0;
+    getIntegerParam(axis, profileUseAxis_, &useAxis);
+    if (!pAxis || !useAxis) continue;
+    if (pAxis->jogging_ || pAxis->approaching_ || pAxis->moving_ || pAxis->deferredMove_) {
+      sprintf(message, "Axis %d is %s", axis,
+              pAxis->jogging_ ? "jogging" : pAxis->approaching_ ? "approaching" : "moving");
+      setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_FAILURE);
+      setStringParam(profileExecuteMessage_, message);
+      callParamCallbacks();
+      return asynError;
+    }
+  }
+
+  profileAborted_ = false;
+  epicsEventTryWait(profileAbortEvent_);
+  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_MOVE_START);
+  setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_UNDEFINED);
+  setStringParam(profileExecuteMessage_, "");
+  callParamCallbacks();
+  epicsEventSignal(profileStartEvent_);
+  return asynSuccess;
+}
+
+/** Aborts an executing profile and stops its axes.  Called with the controller lock held. */
+asynStatus ANC150Controller::abortProfile()
+{
+  ANC150Axis *pAxis;
+  int executeState, useAxis, axis;
+
+  getIntegerParam(profileExecuteState_, &executeState);
+  if (!profileAbortEvent_ || executeState == PROFILE_EXECUTE_DONE)
+    return asynSuccess;
+
+  profileAborted_ = true;
+  epicsEventSignal(profileAbortEvent_);
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    useAxis = 0;
+    getIntegerParam(axis, profileUseAxis_, &useAxis);
+    if (pAxis && useAxis)
+      pAxis->stop(0.);
+  }
+  return asynSuccess;
+}
+
+/** Called when asyn clients call pasynFloat64Array->read().
+  * Returns the profile start times; everything else is handled by the base class.
+  * \param[in] pasynUser asynUser structure that encodes the reason and address.
+  * \param[out] value Array of start times.
+  * \param[in] nElements Number of elements in the value array.
+  * \param[out] nIn Number of elements returned. */
+asynStatus ANC150Controller::readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nIn)
+{
+  int numPoints;
+
+  if (pasynUser->reason != ANC150ProfileStartTimes_)
+    return asynMotorController::readFloat64Array(pasynUser, value, nElements, nIn);
+
+  *nIn = 0;
+  if (!profileStartTimes_)
+    return asynSuccess;
+  getIntegerParam(profileNumPoints_, &numPoints);
+  *nIn = ((size_t) numPoints < nElements) ? numPoints : nElements;
+  if (*nIn > maxProfilePoints_)
+    *nIn = maxProfilePoints_;
+  memcpy(value, profileStartTimes_, *nIn * sizeof(double));
+  return asynSuccess;
+}
+
+/** Body of the profile thread; executes each profile signalled by executeProfile(). */
+void ANC150Controller::profileThread()
+{
+  while (true) {
+    epicsEventWait(profileStartEvent_);
+    runProfile();
+  }
+}
+
+/** Executes the built profile.  Called on the profile thread without the controller lock held;
+  * the lock is only taken to update the axes after each burst. */
+void ANC150Controller::runProfile()
+{
+  ANC150Command cmds[ANC150_MAX_AXES];
+  ANC150Axis *pAxes[ANC150_MAX_AXES];
+  int useAxis[ANC150_MAX_AXES];
+  long position[ANC150_MAX_AXES];
+  long target, steps;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  int executeStatus = PROFILE_STATUS_SUCCESS;
+  int numPoints, timeMode, axis, point, nCmds;
+  double fixedTime, interval, maxInterval = 0.0, late, maxLate = 0.0;
+  epicsTime base, deadline, start;
+  asynStatus status;
+
+  message[0] = 0;
+  lock();
+  getIntegerParam(profileNumPoints_, &numPoints);
+  getIntegerParam(profileTimeMode_, &timeMode);
+  getDoubleParam(profileFixedTime_, &fixedTime);
+  if ((size_t) numPoints > maxProfilePoints_)
+    numPoints = (int) maxProfilePoints_;
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxes[axis] = getAxis(axis);
+    useAxis[axis] = 0;
+    getIntegerParam(axis, profileUseAxis_, &useAxis[axis]);
+    if (!pAxes[axis])
+      useAxis[axis] = 0;
+    else
+      position[axis] = NINT(pAxes[axis]->targetPosition_);
+  }
+  memset(profileStartTimes_, 0, numPoints * sizeof(double));
+  unlock();
+
+  deadline = epicsTime::getCurrent();
+  for (point=0; point<numPoints; point++) {
+    if (point == 1)
+      deadline = base;
+    else if (point > 1)
+      deadline += (timeMode == PROFILE_TIME_MODE_FIXED) ? fixedTime : profileTimes_[point - 2];
+
+    /* Sleep to the absolute deadline; an abort wakes us at once. */
+    epicsEventWaitWithTimeout(profileAbortEvent_, deadline - epicsTime::getCurrent());
+    if (profileAborted_) {
+      executeStatus = PROFILE_STATUS_ABORT;
+      sprintf(message, "Aborted before point %d", point);
+      break;
+    }
+
+    nCmds = 0;
+    for (axis=0; axis<numAxes_; axis++) {
+      if (!useAxis[axis]) continue;
+      steps = NINT(pAxes[axis]->profilePositions_[point]) - position[axis];
+      if (steps != 0)
+        pAxes[axis]->formatStep(steps, cmds[nCmds++].command);
+    }
+    start = epicsTime::getCurrent();
+    status = (nCmds > 0) ? sendCommands(cmds, nCmds) : asynSuccess;
+    if (point > 0) {
+      late = start - deadline;
+      if (late > maxLate)
+        maxLate = late;
+    }
+
+    lock();
+    maxInterval = 0.0;
+    for (axis=0; axis<numAxes_; axis++) {
+      if (!useAxis[axis]) continue;
+      target = NINT(pAxes[axis]->profilePositions_[point]);
+      steps = target - position[axis];
+      if (steps != 0 && status == asynSuccess) {
+        pAxes[axis]->currentPosition_ = pAxes[axis]->targetPosition_;
+        pAxes[axis]->targetPosition_ = (double) target;
+        pAxes[axis]->startTimer(steps, start);
+        pAxes[axis]->setIntegerParam(motorStatusDirection_, steps > 0);
+        interval = pAxes[axis]->moveInterval_;
+        if (interval > maxInterval)
+          maxInterval = interval;
+      }
+      position[axis] = target;
+      pAxes[axis]->profileReadbacks_[point] = (double) target;
+      pAxes[axis]->profileFollowingErrors_[point] = 0.0;
+    }
+    if (point == 0) {
+      base = start + maxInterval;
+      setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
+    } else {
+      profileStartTimes_[point] = start - base;
+    }
+    setIntegerParam(profileCurrentPoint_, point + 1);
+    setDoubleParam(ANC150ProfileMaxLate_, maxLate);
+    callParamCallbacks();
+    unlock();
+    wakeupPoller();
+
+    if (status != asynSuccess) {
+      executeStatus = PROFILE_STATUS_FAILURE;
+      sprintf(message, "Step command failed at point %d", point);
+      break;
+    }
+  }
+
+  /* Wait for the last move to finish. */
+  if (executeStatus == PROFILE_STATUS_SUCCESS) {
+    epicsEventWaitWithTimeout(profileAbortEvent_, (start + maxInterval) - epicsTime::getCurrent());
+    if (profileAborted_) {
+      executeStatus = PROFILE_STATUS_ABORT;
+      strcpy(message, "Aborted after last point");
+    } else {
+      sprintf(message, "Max start lateness %.3f ms", 1000. * maxLate);
+    }
+  }
+
+  lock();
+  setIntegerParam(profileNumReadbacks_, point);
+  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
+  setIntegerParam(profileExecuteStatus_, executeStatus);
+  setStringParam(profileExecuteMessage_, message);
+  callParamCallbacks();
+  doCallbacksFloat64Array(profileStartTimes_, numPoints, ANC150ProfileStartTimes_, 0);
+  unlock();
+}
+
+/** Allocates the profile of an existing ANC150 controller and starts its profile thread.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName  The asyn port name given to ANC150CreateController
+  * \param[in] maxPoints The maximum number of profile points
+  */
+extern "C" int ANC150CreateProfile(const char *portName, int maxPoints)
+{
+  ANC150Controller *pC;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150CreateProfile: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  if (maxPoints < 2) {
+    printf("ANC150CreateProfile: maxPoints must be at least 2\n");
+    return(asynError);
+  }
+  pC->lock();
+  pC->initializeProfile(maxPoints);
+  pC->unlock();
+  return(asynSuccess);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150CreateProfileArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150CreateProfileArg1 = {"Max points", iocshArgInt};
+static const iocshArg * const ANC150CreateProfileArgs[] = {&ANC150CreateProfileArg0,
+                                                           &ANC150CreateProfileArg1};
+static const iocshFuncDef ANC150CreateProfileDef = {"ANC150CreateProfile", 2, ANC150CreateProfileArgs};
+static void ANC150CreateProfileCallFunc(const iocshArgBuf *args)
+{
+  ANC150CreateProfile(args[0].sval, args[1].ival);
+}
+
+static void ANC150ProfileRegister(void)
+{
+  iocshRegister(&ANC150CreateProfileDef, ANC150CreateProfileCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150ProfileRegister);
+}
@@ -0,0 +1,800 @@
+/*
+FILENAME...     ANC150Sim.cpp
+USAGE...        Simulated attocube systems AG ANC150 and ANC300 Piezo Step
+                Controllers, registered as asyn octet ports.
+
+*/
+
+/*
+ * The simulator implements the subset of the ANC150 command set used by
+ * ANC150Driver.cpp (ver, getf, setf, getm, setm, stepu, stepd, stop; "stepu n c"
+ * and "stepd n c" step continuously until "stop") with the
+ * controller's framing: every command is echoed, followed by the reply line,
+ * an acknowledge line ("OK" or "ERROR") and the "> " prompt.  The output and
+ * input EOS are handled by the standard asyn EOS interpose layer, so
+ * ANC150CreateController() connects to it exactly as to a serial port.
+ *
+ * Wire delay is modelled from the configured baud rate (10 bits per
+ * character) on both writes and reads.  The rate is also the port's "baud"
+ * option, as on a serial port, so asynSetOption can change it.  For testing error paths an axis can be
+ * taken out of computer control mode, and replies to a number of commands can
+ * be dropped to force timeouts.  As the ANC150 does, an axis out of computer
+ * control mode answers with its error frame followed by a second "ERROR"
+ * frame that echoes no command.
+ *
+ * ANC300SimConfig() simulates an ANC300 instead: no reply line for commands
+ * without a reply, "frequency = <n> Hz", a two-line reply to "ver", more axes
+ * and a wider frequency range.  Given a TCP port number it also serves the
+ * simulator on that port of the loopback interface, one client at a time, as a
+ * local stand-in for the controller's telnet port; ANC300CreateController()
+ * then connects to it through drvAsynIPPortConfigure("...", "localhost:<port>").
+ *
+ * Each axis also has an actual position, in nominal steps, that moves by a
+ * separate step size up and down, as a slip-stick stage does.
+ * ANC150SimSensor() registers a second asyn port that reads the actual
+ * positions through asynFloat64 (address = axis index, 0 to numAxes-1), to be
+ * used as the external position source of ANC150ConfigFeedback().
+ *
+ * iocsh commands:
+ *   ANC150SimConfig(portName, numAxes, baud)
+ *   ANC300SimConfig(portName, numAxes, tcpPort)
+ *   ANC150SimControlMode(portName, axis, enable)
+ *   ANC150SimTimeouts(portName, count)
+ *   ANC150SimStepSize(portName, axis, up, down)
+ *   ANC150SimSensor(sensorPortName, portName)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsMutex.h>
+#include <epicsString.h>
+#include <epicsStdio.h>
+#include <cantProceed.h>
+#include <osiSock.h>
+#include <iocsh.h>
+
+#include <asynDriver.h>
+#include <asynOctet.h>
+#include <asynFloat64.h>
+
+#include "ANC150Driver.h"
+#include <epicsExport.h>
+
+#define ANC150_SIM_REPLY_SIZE 2048  /* Size of the pending reply buffer */
+#define ANC150_SIM_LINE_SIZE 64     /* Size of the partial command line buffer */
+
+typedef struct ANC150SimAxis {
+  int frequency;            /* Step frequency (Hz). */
+  bool stepMode;            /* true = "stp", false = "gnd". */
+  bool computerControl;     /* false makes every axis command fail. */
+  long position;            /* Net steps taken. */
+  int jog;                  /* Direction of continuous stepping; 0 if none. */
+  epicsTimeStamp jogStart;  /* Start of continuous stepping at the current frequency. */
+  double actual;            /* Actual position (nominal steps). */
+  double stepUp;            /* Actual size of a step up (nominal steps). */
+  double stepDown;          /* Actual size of a step down (nominal steps). */
+} ANC150SimAxis;
+
+typedef struct ANC150Sim {
+  char *portName;
+  const ANC150Protocol *pProtocol; /* Model simulated. */
+  int numAxes;
+  int baud;                 /* 0 for no wire delay. */
+  double charTime;          /* Wire time per character (sec); 0 for no delay. */
+  epicsMutexId lock;
+  asynInterface common;
+  asynInterface octet;
+  asynInterface option;
+  char line[ANC150_SIM_LINE_SIZE];
+  size_t lineLen;
+  char reply[ANC150_SIM_REPLY_SIZE];
+  size_t replyLen;
+  size_t replyPos;
+  int dropCount;            /* Number of commands still to be left unanswered. */
+  ANC150SimAxis axis[ANC150_MAX_AXES];
+  SOCKET listenSocket;      /* TCP stand-in; INVALID_SOCKET if none. */
+  struct ANC150Sim *pNext;
+} ANC150Sim;
+
+/** A position sensor port reading the actual positions of a simulator. */
+typedef struct ANC150SimSensorPort {
+  ANC150Sim *pSim;
+  asynInterface common;
+  asynInterface float64;
+} ANC150SimSensorPort;
+
+static ANC150Sim *pFirstSim = NULL;
+
+static ANC150Sim *findSim(const char *portName)
+{
+  ANC150Sim *pSim;
+
+  for (pSim = pFirstSim; pSim; pSim = pSim->pNext) {
+    if (strcmp(pSim->portName, portName) == 0)
+      return(pSim);
+  }
+  printf("ANC150Sim: port %s not found\n", portName ? portName : "(null)");
+  return(NULL);
+}
+
+static void wireDelay(ANC150Sim *pSim, size_t nChars)
+{
+  if (pSim->charTime > 0.0 && nChars > 0)
+    epicsThreadSleep(pSim->charTime * nChars);
+}
+
+/** Appends one reply frame to the pending reply buffer.  Called with pSim->lock held. */
+static void appendFrame(ANC150Sim *pSim, const char *echo, const char *reply, bool ok)
+{
+  int len;
+
+  if (reply[0] == 0 && !pSim->pProtocol->emptyReply)
+    len = epicsSnprintf(&pSim->reply[pSim->replyLen], sizeof(pSim->reply) - pSim->replyLen,
+                        "%s\r\n%s\r\n> ", echo, ok ? "OK" : "ERROR");
+  else
+    len = epicsSnprintf(&pSim->reply[pSim->replyLen], sizeof(pSim->reply) - pSim->replyLen,
+                        "%s\r\n%s\r\n%s\r\n> ", echo, reply, ok ? "OK" : "ERROR");
+  if (len > 0 && pSim->replyLen + len < sizeof(pSim->reply))
+    pSim->replyLen += len;
+}
+
+/** Appends text that is not a reply frame, e.g. a trailing message.  Called with pSim->lock held. */
+static void appendText(ANC150Sim *pSim, const char *text)
+{
+  size_t len = strlen(text);
+
+  if (pSim->replyLen + len < sizeof(pSim->reply)) {
+    memcpy(&pSim->reply[pSim->replyLen], text, len);
+    pSim->replyLen += len;
+  }
+}
+
+/** Takes steps; negative steps are down.  Called with pSim->lock held. */
+static void takeSteps(ANC150SimAxis *pAxis, long steps)
+{
+  pAxis->position += steps;
+  pAxis->actual += steps * ((steps > 0) ? pAxis->stepUp : pAxis->stepDown);
+}
+
+/** Takes the steps of continuous stepping so far and restarts the count.
+  * Called with pSim->lock held. */
+static void updateJog(ANC150SimAxis *pAxis)
+{
+  epicsTimeStamp now;
+
+  if (!pAxis->jog)
+    return;
+  epicsTimeGetCurrent(&now);
+  takeSteps(pAxis, pAxis->jog * (long) (pAxis->frequency * epicsTimeDiffInSeconds(&now, &pAxis->jogStart)));
+  pAxis->jogStart = now;
+}
+
+/** Executes one command line.  Called with pSim->lock held. */
+static void processCommand(ANC150Sim *pSim, const char *line)
+{
+  char command[16];
+  char arg[32];
+  char reply[ANC150_BUFFER_SIZE];
+  int axisNo = 0;
+  long value;
+  int nArgs;
+  ANC150SimAxis *pAxis;
+
+  if (pSim->dropCount > 0) {
+    pSim->dropCount--;
+    return;
+  }
+
+  arg[0] = 0;
+  nArgs = sscanf(line, "%15s %d %31s", command, &axisNo, arg);
+  if (nArgs < 1)
+    return;
+
+  if (pSim->pProtocol->login && strcmp(line, pSim->pProtocol->login) == 0) {
+    appendFrame(pSim, line, "Authorization success", true);
+    return;
+  }
+  if (strcmp(command, "ver") == 0) {
+    if (pSim->pProtocol == &ANC150ProtocolANC300) {
+      epicsSnprintf(reply, sizeof(reply), "attocube ANC300 controller version 1.0.0 (simulated)\r\n"
+                    "%d ANM150 modules", pSim->numAxes);
+      appendFrame(pSim, line, reply, true);
+    }
+    else
+      appendFrame(pSim, line, "attocube ANC150 v. 1.0.0 (simulated)", true);
+    return;
+  }
+
+  if (nArgs < 2 || axisNo < 1 || axisNo > pSim->numAxes) {
+    appendFrame(pSim, line, "Wrong axis number", false);
+    return;
+  }
+  pAxis = &pSim->axis[axisNo - 1];
+  if (!pAxis->computerControl) {
+    appendFrame(pSim, line, "Axis not in computer control mode", false);
+    if (pSim->pProtocol == &ANC150ProtocolANC150)
+      appendText(pSim, "ERROR\r\n> ");
+    return;
+  }
+
+  if (strcmp(command, "getf") == 0) {
+    epicsSnprintf(reply, sizeof(reply), "frequency = %d%s", pAxis->frequency, pSim->pProtocol->frequencyUnit);
+    appendFrame(pSim, line, reply, true);
+  }
+  else if (strcmp(command, "getm") == 0) {
+    appendFrame(pSim, line, pAxis->stepMode ? "mode = stp" : "mode = gnd", true);
+  }
+  else if (strcmp(command, "setf") == 0) {
+    value = atol(arg);
+    if (nArgs < 3 || value < pSim->pProtocol->minFrequency || value > pSim->pProtocol->maxFrequency)
+      appendFrame(pSim, line, "Value out of range", false);
+    else {
+      updateJog(pAxis);
+      pAxis->frequency = (int) value;
+      appendFrame(pSim, line, "", true);
+    }
+  }
+  else if (strcmp(command, "setm") == 0) {
+    if (strcmp(arg, "stp") == 0)
+      pAxis->stepMode = true;
+    else if (strcmp(arg, "gnd") == 0)
+      pAxis->stepMode = false;
+    else {
+      appendFrame(pSim, line, "Unknown mode", false);
+      return;
+    }
+    appendFrame(pSim, line, "", true);
+  }
+  else if (strcmp(command, "stepu") == 0 || strcmp(command, "stepd") == 0) {
+    updateJog(pAxis);
+    pAxis->jog = 0;
+    if (strcmp(arg, "c") == 0) {
+      pAxis->jog = (command[4] == 'u') ? 1 : -1;
+      epicsTimeGetCurrent(&pAxis->jogStart);
+    } else {
+      value = (nArgs < 3) ? 1 : atol(arg);
+      takeSteps(pAxis, (command[4] == 'u') ? value : -value);
+    }
+    appendFrame(pSim, line, "", true);
+  }
+  else if (strcmp(command, "stop") == 0) {
+    updateJog(pAxis);
+    pAxis->jog = 0;
+    appendFrame(pSim, line, "", true);
+  }
+  else {
+    appendFrame(pSim, line, "Unknown command", false);
+  }
+}
+
+static void simReport(void *drvPvt, FILE *fp, int details)
+{
+  ANC150Sim *pSim = (ANC150Sim *) drvPvt;
+  int i;
+
+  fprintf(fp, "%s simulator %s, numAxes=%d, char time=%g s%s\n", pSim->pProtocol->model,
+          pSim->portName, pSim->numAxes, pSim->charTime,
+          (pSim->listenSocket != INVALID_SOCKET) ? ", serving TCP" : "");
+  if (details > 0) {
+    for (i=0; i<pSim->numAxes; i++) {
+      fprintf(fp, "  axis %d: frequency=%d mode=%s control=%s position=%ld%s actual=%g\n", i + 1,
+              pSim->axis[i].frequency, pSim->axis[i].stepMode ? "stp" : "gnd",
+              pSim->axis[i].computerControl ? "computer" : "manual", pSim->axis[i].position,
+              pSim->axis[i].jog ? " (continuous)" : "", pSim->axis[i].actual);
+    }
+  }
+}
+
+static asynStatus simConnect(void *drvPvt, asynUser *pasynUser)
+{
+  pasynManager->exceptionConnect(pasynUser);
+  return(asynSuccess);
+}
+
+static asynStatus simDisconnect(void *drvPvt, asynUser *pasynUser)
+{
+  pasynManager->exceptionDisconnect(pasynUser);
+  return(asynSuccess);
+}
+
+/** Splits received characters into command lines and executes them. */
+static void receive(ANC150Sim *pSim, const char *data, size_t numchars)
+{
+  size_t i;
+
+  epicsMutexLock(pSim->lock);
+  for (i=0; i<numchars; i++) {
+    if (data[i] == '\r' || data[i] == '\n') {
+      if (pSim->lineLen > 0) {
+        pSim->line[pSim->lineLen] = 0;
+        processCommand(pSim, pSim->line);
+      }
+      pSim->lineLen = 0;
+    }
+    else if (pSim->lineLen < sizeof(pSim->line) - 1)
+      pSim->line[pSim->lineLen++] = data[i];
+  }
+  epicsMutexUnlock(pSim->lock);
+}
+
+static asynStatus simWrite(void *drvPvt, asynUser *pasynUser, const char *data,
+                           size_t numchars, size_t *nbytesTransfered)
+{
+  ANC150Sim *pSim = (ANC150Sim *) drvPvt;
+
+  wireDelay(pSim, numchars);
+  asynPrintIO(pasynUser, ASYN_TRACEIO_DRIVER, data, numchars,
+              "%s write %lu\n", pSim->portName, (unsigned long) numchars);
+  receive(pSim, data, numchars);
+
+  *nbytesTransfered = numchars;
+  return(asynSuccess);
+}
+
+static asynStatus simRead(void *drvPvt, asynUser *pasynUser, char *data,
+                          size_t maxchars, size_t *nbytesTransfered, int *eomReason)
+{
+  ANC150Sim *pSim = (ANC150Sim *) drvPvt;
+  size_t nRead;
+
+  *nbytesTransfered = 0;
+  if (eomReason)
+    *eomReason = 0;
+
+  epicsMutexLock(pSim->lock);
+  nRead = pSim->replyLen - pSim->replyPos;
+  if (nRead > maxchars)
+    nRead = maxchars;
+  memcpy(data, &pSim->reply[pSim->replyPos], nRead);
+  pSim->replyPos += nRead;
+  if (pSim->replyPos == pSim->replyLen)
+    pSim->replyPos = pSim->replyLen = 0;
+  epicsMutexUnlock(pSim->lock);
+
+  if (nRead == 0) {
+    /* Nothing pending; behave like a controller that does not answer. */
+    if (pasynUser->timeout > 0)
+      epicsThreadSleep(pasynUser->timeout);
+    epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize,
+                  "%s timeout", pSim->portName);
+    return(asynTimeout);
+  }
+
+  wireDelay(pSim, nRead);
+  asynPrintIO(pasynUser, ASYN_TRACEIO_DRIVER, data, nRead,
+              "%s read %lu\n", pSim->portName, (unsigned long) nRead);
+  *nbytesTransfered = nRead;
+  if (eomReason && nRead == maxchars)
+    *eomReason = ASYN_EOM_CNT;
+  return(asynSuccess);
+}
+
+static asynStatus simFlush(void *drvPvt, asynUser *pasynUser)
+{
+  ANC150Sim *pSim = (ANC150Sim *) drvPvt;
+
+  epicsMutexLock(pSim->lock);
+  pSim->replyPos = pSim->replyLen = 0;
+  epicsMutexUnlock(pSim->lock);
+  return(asynSuccess);
+}
+
+/** Sets the "baud" option, as asynSetOption does on a serial port. */
+static asynStatus simSetOption(void *drvPvt, asynUser *pasynUser, const char *key, const char *val)
+{
+  ANC150Sim *pSim = (ANC150Sim *) drvPvt;
+  int baud;
+
+  if (epicsStrCaseCmp(key, "baud") != 0 || sscanf(val, "%d", &baud) != 1 || baud < 0) {
+    epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize,
+                  "%s: unsupported option %s=%s", pSim->portName, key, val);
+    return(asynError);
+  }
+  epicsMutexLock(pSim->lock);
+  pSim->baud = baud;
+  pSim->charTime = (baud > 0) ? 10.0 / baud : 0.0;
+  epicsMutexUnlock(pSim->lock);
+  return(asynSuccess);
+}
+
+/** Reports the "baud" option, so the driver can derive its timeouts from it. */
+static asynStatus simGetOption(void *drvPvt, asynUser *pasynUser, const char *key, char *val, int sizeval)
+{
+  ANC150Sim *pSim = (ANC150Sim *) drvPvt;
+
+  if (epicsStrCaseCmp(key, "baud") != 0) {
+    epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize,
+                  "%s: unsupported option %s", pSim->portName, key);
+    return(asynError);
+  }
+  epicsSnprintf(val, sizeval, "%d", pSim->baud);
+  return(asynSuccess);
+}
+
+static asynCommon simCommon = {simReport, simConnect, simDisconnect};
+static asynOption simOption = {simSetOption, simGetOption};
+
+/** Body of the TCP stand-in thread: serves one client at a time, sending the
+  * pending replies after every receive. */
+static void simServer(ANC150Sim *pSim)
+{
+  char input[ANC150_BUFFER_SIZE];
+  char output[ANC150_SIM_REPLY_SIZE];
+  osiSockAddr address;
+  osiSocklen_t addressLen;
+  SOCKET client;
+  size_t nOutput;
+  int nInput;
+
+  while (true) {
+    addressLen = sizeof(address.sa);
+    client = epicsSocketAccept(pSim->listenSocket, &address.sa, &addressLen);
+    if (client == INVALID_SOCKET) {
+      epicsThreadSleep(1.0);
+      continue;
+    }
+    epicsMutexLock(pSim->lock);
+    pSim->lineLen = 0;
+    pSim->replyPos = pSim->replyLen = 0;
+    epicsMutexUnlock(pSim->lock);
+
+    while ((nInput = recv(client, input, sizeof(input), 0)) > 0) {
+      receive(pSim, input, nInput);
+      epicsMutexLock(pSim->lock);
+      nOutput = pSim->replyLen - pSim->replyPos;
+      memcpy(output, &pSim->reply[pSim->replyPos], nOutput);
+      pSim->replyPos = pSim->replyLen = 0;
+      epicsMutexUnlock(pSim->lock);
+      if (nOutput > 0 && send(client, output, (int) nOutput, 0) != (int) nOutput)
+        break;
+    }
+    epicsSocketDestroy(client);
+  }
+}
+
+static void simServerC(void *pPvt)
+{
+  simServer((ANC150Sim *) pPvt);
+}
+
+/** Starts serving a simulator on a TCP port of the loopback interface.
+  * \param[in] pSim The simulator.
+  * \param[in] tcpPort The TCP port number. */
+static asynStatus simListen(ANC150Sim *pSim, int tcpPort)
+{
+  osiSockAddr address;
+
+  if (osiSockAttach() == 0)
+    return(asynError);
+  pSim->listenSocket = epicsSocketCreate(AF_INET, SOCK_STREAM, 0);
+  if (pSim->listenSocket == INVALID_SOCKET)
+    return(asynError);
+  epicsSocketEnableAddressReuseDuringTimeWaitState(pSim->listenSocket);
+  memset(&address, 0, sizeof(address));
+  address.ia.sin_family = AF_INET;
+  address.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.ia.sin_port = htons((unsigned short) tcpPort);
+  if (bind(pSim->listenSocket, &address.sa, sizeof(address.ia)) != 0 ||
+      listen(pSim->listenSocket, 1) != 0) {
+    epicsSocketDestroy(pSim->listenSocket);
+    pSim->listenSocket = INVALID_SOCKET;
+    return(asynError);
+  }
+  epicsThreadCreate("ANC150SimServer", epicsThreadPriorityMedium,
+                    epicsThreadGetStackSize(epicsThreadStackMedium),
+                    (EPICSTHREADFUNC) simServerC, pSim);
+  return(asynSuccess);
+}
+
+static void sensorReport(void *drvPvt, FILE *fp, int details)
+{
+  ANC150SimSensorPort *pSensor = (ANC150SimSensorPort *) drvPvt;
+
+  fprintf(fp, "ANC150 simulated position sensor of %s\n", pSensor->pSim->portName);
+}
+
+static asynStatus sensorRead(void *drvPvt, asynUser *pasynUser, epicsFloat64 *value)
+{
+  ANC150SimSensorPort *pSensor = (ANC150SimSensorPort *) drvPvt;
+  ANC150Sim *pSim = pSensor->pSim;
+  int addr;
+
+  pasynManager->getAddr(pasynUser, &addr);
+  if (addr < 0 || addr >= pSim->numAxes) {
+    epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "invalid axis %d", addr);
+    return(asynError);
+  }
+  epicsMutexLock(pSim->lock);
+  updateJog(&pSim->axis[addr]);
+  *value = pSim->axis[addr].actual;
+  epicsMutexUnlock(pSim->lock);
+  return(asynSuccess);
+}
+
+static asynStatus sensorWrite(void *drvPvt, asynUser *pasynUser, epicsFloat64 value)
+{
+  epicsSnprintf(pasynUser->errorMessage, pasynUser->errorMessageSize, "sensor is read only");
+  return(asynError);
+}
+
+static asynCommon sensorCommon = {sensorReport, simConnect, simDisconnect};
+static asynFloat64 sensorFloat64 = {sensorWrite, sensorRead};
+
+/** Creates a simulated controller and registers it as an asyn octet port.
+  * \param[in] functionName The configuration command, for error messages
+  * \param[in] pProtocol The model to simulate
+  * \param[in] portName The name of the asyn port to create
+  * \param[in] numAxes  The number of axes of the simulated controller
+  * \param[in] baud     The baud rate used to model wire delay; 0 for no delay
+  * \return The simulator, or NULL on error. */
+static ANC150Sim *createSim(const char *functionName, const ANC150Protocol *pProtocol,
+                            const char *portName, int numAxes, int baud)
+{
+  ANC150Sim *pSim;
+  asynOctet *pOctet;
+  asynStatus status;
+  int i;
+
+  if (!portName || (numAxes < 1) || (numAxes > pProtocol->maxAxes)) {
+    printf("%s: numAxes must in range 1 to %d\n", functionName, pProtocol->maxAxes);
+    return(NULL);
+  }
+
+  pSim = (ANC150Sim *) callocMustSucceed(1, sizeof(ANC150Sim), functionName);
+  pOctet = (asynOctet *) callocMustSucceed(1, sizeof(asynOctet), functionName);
+  pSim->portName = epicsStrDup(portName);
+  pSim->pProtocol = pProtocol;
+  pSim->numAxes = numAxes;
+  pSim->baud = (baud > 0) ? baud : 0;
+  pSim->charTime = (baud > 0) ? 10.0 / baud : 0.0;
+  pSim->listenSocket = INVALID_SOCKET;
+  pSim->lock = epicsMutexMustCreate();
+  for (i=0; i<numAxes; i++) {
+    pSim->axis[i].frequency = 1000;
+    pSim->axis[i].stepMode = false;
+    pSim->axis[i].computerControl = true;
+    pSim->axis[i].stepUp = pSim->axis[i].stepDown = 1.0;
+  }
+
+  status = pasynManager->registerPort(portName, ASYN_CANBLOCK, 1, 0, 0);
+  if (status != asynSuccess) {
+    printf("%s: registerPort failed for %s\n", functionName, portName);
+    return(NULL);
+  }
+
+  pSim->common.interfaceType = asynCommonType;
+  pSim->common.pinterface = (void *) &simCommon;
+  pSim->common.drvPvt = pSim;
+  pasynManager->registerInterface(portName, &pSim->common);
+
+  pSim->option.interfaceType = asynOptionType;
+  pSim->option.pinterface = (void *) &simOption;
+  pSim->option.drvPvt = pSim;
+  pasynManager->registerInterface(portName, &pSim->option);
+
+  pOctet->write = simWrite;
+  pOctet->read = simRead;
+  pOctet->flush = simFlush;
+  pSim->octet.interfaceType = asynOctetType;
+  pSim->octet.pinterface = pOctet;
+  pSim->octet.drvPvt = pSim;
+  status = pasynOctetBase->initialize(portName, &pSim->octet, 1, 1, 0);
+  if (status != asynSuccess) {
+    printf("%s: pasynOctetBase->initialize failed for %s\n", functionName, portName);
+    return(NULL);
+  }
+
+  pSim->pNext = pFirstSim;
+  pFirstSim = pSim;
+  return(pSim);
+}
+
+/** Creates a simulated ANC150 controller and registers it as an asyn octet port.
+  * \param[in] portName The name of the asyn port to create
+  * \param[in] numAxes  The number of axes of the simulated controller
+  * \param[in] baud     The baud rate used to model wire delay; 0 for no delay
+  */
+extern "C" int ANC150SimConfig(const char *portName, int numAxes, int baud)
+{
+  return(createSim("ANC150SimConfig", &ANC150ProtocolANC150, portName, numAxes, baud) ? asynSuccess : asynError);
+}
+
+/** Creates a simulated ANC300 controller, registers it as an asyn octet port
+  * and optionally serves it on a TCP port of the loopback interface.
+  * \param[in] portName The name of the asyn port to create
+  * \param[in] numAxes  The number of axes of the simulated controller
+  * \param[in] tcpPort  The TCP port to serve the simulator on; 0 for none
+  */
+extern "C" int ANC300SimConfig(const char *portName, int numAxes, int tcpPort)
+{
+  ANC150Sim *pSim;
+
+  pSim = createSim("ANC300SimConfig", &ANC150ProtocolANC300, portName, numAxes, 0);
+  if (!pSim)
+    return(asynError);
+  if (tcpPort > 0 && simListen(pSim, tcpPort) != asynSuccess) {
+    printf("ANC300SimConfig: cannot listen on TCP port %d\n", tcpPort);
+    return(asynError);
+  }
+  return(asynSuccess);
+}
+
+/** Puts an axis of a simulated controller into or out of computer control mode.
+  * \param[in] portName The name of the simulator port
+  * \param[in] axis     The axis number, 1 to numAxes
+  * \param[in] enable   0 makes every command for the axis fail with "Axis not in computer control mode"
+  */
+extern "C" int ANC150SimControlMode(const char *portName, int axis, int enable)
+{
+  ANC150Sim *pSim = findSim(portName);
+
+  if (!pSim)
+    return(asynError);
+  if ((axis < 1) || (axis > pSim->numAxes)) {
+    printf("ANC150SimControlMode: axis must in range 1 to %d\n", pSim->numAxes);
+    return(asynError);
+  }
+  epicsMutexLock(pSim->lock);
+  pSim->axis[axis - 1].computerControl = (enable != 0);
+  epicsMutexUnlock(pSim->lock);
+  return(asynSuccess);
+}
+
+/** Leaves the next commands sent to a simulated controller unanswered.
+  * \param[in] portName The name of the simulator port
+  * \param[in] count    The number of commands to drop
+  */
+extern "C" int ANC150SimTimeouts(const char *portName, int count)
+{
+  ANC150Sim *pSim = findSim(portName);
+
+  if (!pSim)
+    return(asynError);
+  epicsMutexLock(pSim->lock);
+  pSim->dropCount = (count > 0) ? count : 0;
+  epicsMutexUnlock(pSim->lock);
+  return(asynSuccess);
+}
+
+/** Sets the actual step sizes of an axis of a simulated controller.
+  * \param[in] portName The name of the simulator port
+  * \param[in] axis     The axis number, 1 to numAxes
+  * \param[in] up       The actual size of a step up, in nominal steps
+  * \param[in] down     The actual size of a step down, in nominal steps
+  */
+extern "C" int ANC150SimStepSize(const char *portName, int axis, double up, double down)
+{
+  ANC150Sim *pSim = findSim(portName);
+
+  if (!pSim)
+    return(asynError);
+  if ((axis < 1) || (axis > pSim->numAxes) || (up <= 0.0) || (down <= 0.0)) {
+    printf("ANC150SimStepSize: axis must in range 1 to %d and step sizes positive\n", pSim->numAxes);
+    return(asynError);
+  }
+  epicsMutexLock(pSim->lock);
+  updateJog(&pSim->axis[axis - 1]);
+  pSim->axis[axis - 1].stepUp = up;
+  pSim->axis[axis - 1].stepDown = down;
+  epicsMutexUnlock(pSim->lock);
+  return(asynSuccess);
+}
+
+/** Registers an asyn port that reads the actual axis positions of a simulated controller.
+  * \param[in] sensorPortName The name of the asyn port to create
+  * \param[in] portName       The name of the simulator port
+  */
+extern "C" int ANC150SimSensor(const char *sensorPortName, const char *portName)
+{
+  ANC150Sim *pSim = findSim(portName);
+  ANC150SimSensorPort *pSensor;
+  asynStatus status;
+
+  if (!pSim || !sensorPortName)
+    return(asynError);
+
+  pSensor = (ANC150SimSensorPort *) callocMustSucceed(1, sizeof(ANC150SimSensorPort), "ANC150SimSensor");
+  pSensor->pSim = pSim;
+
+  status = pasynManager->registerPort(sensorPortName, ASYN_MULTIDEVICE, 1, 0, 0);
+  if (status != asynSuccess) {
+    printf("ANC150SimSensor: registerPort failed for %s\n", sensorPortName);
+    return(status);
+  }
+  pSensor->common.interfaceType = asynCommonType;
+  pSensor->common.pinterface = (void *) &sensorCommon;
+  pSensor->common.drvPvt = pSensor;
+  pasynManager->registerInterface(sensorPortName, &pSensor->common);
+  pSensor->float64.interfaceType = asynFloat64Type;
+  pSensor->float64.pinterface = (void *) &sensorFloat64;
+  pSensor->float64.drvPvt = pSensor;
+  pasynManager->registerInterface(sensorPortName, &pSensor->float64);
+  return(asynSuccess);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150SimConfigArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150SimConfigArg1 = {"Number of axes", iocshArgInt};
+static const iocshArg ANC150SimConfigArg2 = {"Baud rate", iocshArgInt};
+static const iocshArg * const ANC150SimConfigArgs[] = {&ANC150SimConfigArg0,
+                                                       &ANC150SimConfigArg1,
+                                                       &ANC150SimConfigArg2};
+static const iocshFuncDef ANC150SimConfigDef = {"ANC150SimConfig", 3, ANC150SimConfigArgs};
+static void ANC150SimConfigCallFunc(const iocshArgBuf *args)
+{
+  ANC150SimConfig(args[0].sval, args[1].ival, args[2].ival);
+}
+
+static const iocshArg ANC300SimConfigArg2 = {"TCP port", iocshArgInt};
+static const iocshArg * const ANC300SimConfigArgs[] = {&ANC150SimConfigArg0,
+                                                       &ANC150SimConfigArg1,
+                                                       &ANC300SimConfigArg2};
+static const iocshFuncDef ANC300SimConfigDef = {"ANC300SimConfig", 3, ANC300SimConfigArgs};
+static void ANC300SimConfigCallFunc(const iocshArgBuf *args)
+{
+  ANC300SimConfig(args[0].sval, args[1].ival, args[2].ival);
+}
+
+static const iocshArg ANC150SimControlModeArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150SimControlModeArg1 = {"Axis (1-N)", iocshArgInt};
+static const iocshArg ANC150SimControlModeArg2 = {"Enable", iocshArgInt};
+static const iocshArg * const ANC150SimControlModeArgs[] = {&ANC150SimControlModeArg0,
+                                                            &ANC150SimControlModeArg1,
+                                                            &ANC150SimControlModeArg2};
+static const iocshFuncDef ANC150SimControlModeDef = {"ANC150SimControlMode", 3, ANC150SimControlModeArgs};
+static void ANC150SimControlModeCallFunc(const iocshArgBuf *args)
+{
+  ANC150SimControlMode(args[0].sval, args[1].ival, args[2].ival);
+}
+
+static const iocshArg ANC150SimTimeoutsArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150SimTimeoutsArg1 = {"Number of commands", iocshArgInt};
+static const iocshArg * const ANC150SimTimeoutsArgs[] = {&ANC150SimTimeoutsArg0,
+                                                         &ANC150SimTimeoutsArg1};
+static const iocshFuncDef ANC150SimTimeoutsDef = {"ANC150SimTimeouts", 2, ANC150SimTimeoutsArgs};
+static void ANC150SimTimeoutsCallFunc(const iocshArgBuf *args)
+{
+  ANC150SimTimeouts(args[0].sval, args[1].ival);
+}
+
+static const iocshArg ANC150SimStepSizeArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150SimStepSizeArg1 = {"Axis (1-N)", iocshArgInt};
+static const iocshArg ANC150SimStepSizeArg2 = {"Step up", iocshArgDouble};
+static const iocshArg ANC150SimStepSizeArg3 = {"Step down", iocshArgDouble};
+static const iocshArg * const ANC150SimStepSizeArgs[] = {&ANC150SimStepSizeArg0,
+                                                         &ANC150SimStepSizeArg1,
+                                                         &ANC150SimStepSizeArg2,
+                                                         &ANC150SimStepSizeArg3};
+static const iocshFuncDef ANC150SimStepSizeDef = {"ANC150SimStepSize", 4, ANC150SimStepSizeArgs};
+static void ANC150SimStepSizeCallFunc(const iocshArgBuf *args)
+{
+  ANC150SimStepSize(args[0].sval, args[1].ival, args[2].dval, args[3].dval);
+}
+
+static const iocshArg ANC150SimSensorArg0 = {"Sensor port name", iocshArgString};
+static const iocshArg ANC150SimSensorArg1 = {"Port name", iocshArgString};
+static const iocshArg * const ANC150SimSensorArgs[] = {&ANC150SimSensorArg0,
+                                                       &ANC150SimSensorArg1};
+static const iocshFuncDef ANC150SimSensorDef = {"ANC150SimSensor", 2, ANC150SimSensorArgs};
+static void ANC150SimSensorCallFunc(const iocshArgBuf *args)
+{
+  ANC150SimSensor(args[0].sval, args[1].sval);
+}
+
+static void ANC150SimRegister(void)
+{
+  iocshRegister(&ANC150SimConfigDef, ANC150SimConfigCallFunc);
+  iocshRegister(&ANC300SimConfigDef, ANC300SimConfigCallFunc);
+  iocshRegister(&ANC150SimControlModeDef, ANC150SimControlModeCallFunc);
+  iocshRegister(&ANC150SimTimeoutsDef, ANC150SimTimeoutsCallFunc);
+  iocshRegister(&ANC150SimStepSizeDef, ANC150SimStepSizeCallFunc);
+  iocshRegister(&ANC150SimSensorDef, ANC150SimSensorCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150SimRegister);
+}
@@ -0,0 +1,284 @@
+/*
+FILENAME...     ANC150StepModel.cpp
+USAGE...        Per-direction step size model for the attocube systems AG ANC150
+                Piezo Step Controller.
+
+*/
+
+/*
+ * Slip-stick stages do not step the same distance up and down, and the step
+ * size changes with the step frequency and the load.  The model holds, for
+ * each direction and each of ANC150_MODEL_BINS frequency bins, the measured
+ * distance of one commanded step.  It is learnt from the approach moves of
+ * axes with an external position source (ANC150Feedback.cpp) and used by
+ * ANC150Axis::move() to convert a distance into a step count, for open-loop
+ * axes as well.  A bin averages its first ANC150_MODEL_WINDOW measurements
+ * and then follows drift with an exponential average of the same length.
+ *
+ * ANC150LoadStepModel(portName, fileName) restores the models of all axes of a
+ * controller from a file and makes the poller save them back to it, at most
+ * every ANC150_MODEL_SAVE_PERIOD, when they have changed.  The file has one
+ * line per bin, "axis direction bin gain samples", and may be edited by hand.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <epicsStdio.h>
+#include <epicsString.h>
+#include <epicsTime.h>
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include <epicsExport.h>
+
+#define ANC150_MODEL_WINDOW 16      /* Measurements averaged by a bin */
+
+/* Upper edges (Hz) of all but the last frequency bin. */
+static const int binEdges[ANC150_MODEL_BINS - 1] = {10, 30, 100, 300, 1000, 2000, 4000};
+static const char *directionNames[2] = {"down", "up"};
+
+static int frequencyBin(int frequency)
+{
+  int bin;
+
+  for (bin=0; bin<ANC150_MODEL_BINS - 1 && frequency > binEdges[bin]; bin++)
+    ;
+  return(bin);
+}
+
+/** Sets every bin of a model to the nominal step size and no measurements. */
+void ANC150ModelInit(ANC150StepModel *pModel)
+{
+  int dir, bin;
+
+  for (dir=0; dir<2; dir++) {
+    for (bin=0; bin<ANC150_MODEL_BINS; bin++) {
+      pModel->bins[dir][bin].gain = 1.0;
+      pModel->bins[dir][bin].samples = 0;
+    }
+  }
+}
+
+/** Returns the step size of a direction at a frequency.  A bin without
+  * measurements borrows from the nearest bin that has some.
+  * \param[in] pModel The model.
+  * \param[in] up true for steps up.
+  * \param[in] frequency The step frequency (Hz).
+  * \return Measured steps per commanded step; 1.0 if the direction has no measurements. */
+double ANC150ModelGain(const ANC150StepModel *pModel, bool up, int frequency)
+{
+  const ANC150StepGain *bins = pModel->bins[up ? 1 : 0];
+  int bin = frequencyBin(frequency);
+  int d;
+
+  for (d=0; d<ANC150_MODEL_BINS; d++) {
+    if (bin - d >= 0 && bins[bin - d].samples > 0)
+      return(bins[bin - d].gain);
+    if (bin + d < ANC150_MODEL_BINS && bins[bin + d].samples > 0)
+      return(bins[bin + d].gain);
+  }
+  return(1.0);
+}
+
+/** Adds a measurement to a model.
+  * \param[in,out] pModel The model.
+  * \param[in] up true if the steps were up.
+  * \param[in] frequency The step frequency (Hz).
+  * \param[in] gain Measured distance divided by the commanded steps.
+  * \return false if the measurement is implausible and was ignored. */
+bool ANC150ModelUpdate(ANC150StepModel *pModel, bool up, int frequency, double gain)
+{
+  ANC150StepGain *pBin = &pModel->bins[up ? 1 : 0][frequencyBin(frequency)];
+
+  if (gain <= ANC150_MODEL_GAIN_MIN || gain >= ANC150_MODEL_GAIN_MAX)
+    return(false);
+  if (pBin->samples < ANC150_MODEL_WINDOW)
+    pBin->samples++;
+  pBin->gain += (gain - pBin->gain) / pBin->samples;
+  return(true);
+}
+
+/** Reads the models of a controller's axes from a file.
+  * \param[in] fileName The file.
+  * \param[out] pModels The models, one per axis; bins not in the file are left unchanged.
+  * \param[in] nAxes The number of axes.
+  * \param[out] pNRejected The number of lines that are not valid bins: malformed,
+  *                        out of range or with a direction other than "up" or "down".
+  * \return The number of bins read; 0 if the file does not exist yet, -1 if
+  *         it cannot be opened. */
+int ANC150ModelLoad(const char *fileName, ANC150StepModel *pModels, int nAxes, int *pNRejected)
+{
+  FILE *fp = fopen(fileName, "r");
+  char line[128], direction[8], first;
+  int axis, dir, bin, samples;
+  int nBins = 0;
+  double gain;
+
+  *pNRejected = 0;
+  if (!fp)
+    return((errno == ENOENT) ? 0 : -1);
+  while (fgets(line, sizeof(line), fp)) {
+    if (sscanf(line, " %c", &first) != 1 || first == '#')
+      continue;
+    if (sscanf(line, "%d %7s %d %lf %d", &axis, direction, &bin, &gain, &samples) != 5) {
+      (*pNRejected)++;
+      continue;
+    }
+    if (strcmp(direction, directionNames[1]) == 0)
+      dir = 1;
+    else if (strcmp(direction, directionNames[0]) == 0)
+      dir = 0;
+    else
+      dir = -1;
+    if (dir < 0 || axis < 0 || axis >= nAxes || bin < 0 || bin >= ANC150_MODEL_BINS || samples < 1 ||
+        gain <= ANC150_MODEL_GAIN_MIN || gain >= ANC150_MODEL_GAIN_MAX) {
+      (*pNRejected)++;
+      continue;
+    }
+    pModels[axis].bins[dir][bin].gain = gain;
+    pModels[axis].bins[dir][bin].samples = (samples < ANC150_MODEL_WINDOW) ? samples : ANC150_MODEL_WINDOW;
+    nBins++;
+  }
+  fclose(fp);
+  return(nBins);
+}
+
+/** Writes the measured bins of a controller's models to a file.  The file is
+  * written under a temporary name and renamed, so a crash leaves the old file.
+  * \param[in] fileName The file.
+  * \param[in] pModels The models, one per axis.
+  * \param[in] nAxes The number of axes.
+  * \return 0, or -1 if the file could not be written. */
+int ANC150ModelSave(const char *fileName, const ANC150StepModel *pModels, int nAxes)
+{
+  char tmpName[256];
+  FILE *fp;
+  int axis, dir, bin;
+  int status = 0;
+
+  epicsSnprintf(tmpName, sizeof(tmpName), "%s.tmp", fileName);
+  fp = fopen(tmpName, "w");
+  if (!fp)
+    return(-1);
+  fprintf(fp, "# ANC150 step size model: axis direction bin gain samples\n");
+  for (axis=0; axis<nAxes; axis++) {
+    for (dir=0; dir<2; dir++) {
+      for (bin=0; bin<ANC150_MODEL_BINS; bin++) {
+        if (pModels[axis].bins[dir][bin].samples > 0)
+          fprintf(fp, "%d %s %d %.6f %d\n", axis, directionNames[dir], bin,
+                  pModels[axis].bins[dir][bin].gain, pModels[axis].bins[dir][bin].samples);
+      }
+    }
+  }
+  if (ferror(fp))
+    status = -1;
+  if (fclose(fp) != 0)
+    status = -1;
+  if (status == 0 && rename(tmpName, fileName) != 0)
+    status = -1;
+  return(status);
+}
+
+/** Restores the step size models of all axes from a file and saves them back
+  * to it when they change.  Called with the controller lock held.
+  * \param[in] fileName The file; it need not exist yet. */
+asynStatus ANC150Controller::loadStepModel(const char *fileName)
+{
+  ANC150StepModel models[ANC150_MAX_AXES];
+  ANC150Axis *pAxis;
+  int axis, nBins, nRejected;
+
+  for (axis=0; axis<numAxes_; axis++)
+    models[axis] = getAxis(axis)->stepModel_;
+  nBins = ANC150ModelLoad(fileName, models, numAxes_, &nRejected);
+  if (nBins > 0) {
+    for (axis=0; axis<numAxes_; axis++) {
+      pAxis = getAxis(axis);
+      pAxis->stepModel_ = models[axis];
+    }
+  }
+  if (nBins < 0)
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "ANC150Controller::loadStepModel: cannot read %s\n", fileName);
+  else if (nRejected > 0)
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "ANC150Controller::loadStepModel: %d invalid lines in %s ignored\n", nRejected, fileName);
+  asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+            "ANC150Controller::loadStepModel: %d bins read from %s\n", nBins, fileName);
+
+  free(stepModelFile_);
+  stepModelFile_ = epicsStrDup(fileName);
+  nextStepModelSave_ = epicsTime::getCurrent() + ANC150_MODEL_SAVE_PERIOD;
+  return asynSuccess;
+}
+
+/** Saves the step size models if they have changed and the save period has
+  * passed.  Called from poll() with the controller lock held; the file is
+  * written with it released.
+  * \param[in] now The start of the poll. */
+void ANC150Controller::saveStepModel(const epicsTime &now)
+{
+  ANC150StepModel models[ANC150_MAX_AXES];
+  int axis;
+
+  if (!stepModelFile_ || !stepModelDirty_ || now < nextStepModelSave_)
+    return;
+  for (axis=0; axis<numAxes_; axis++)
+    models[axis] = getAxis(axis)->stepModel_;
+  stepModelDirty_ = false;
+  nextStepModelSave_ = now + ANC150_MODEL_SAVE_PERIOD;
+
+  unlock();
+  if (ANC150ModelSave(stepModelFile_, models, numAxes_) != 0)
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "ANC150Controller::saveStepModel: cannot write %s\n", stepModelFile_);
+  lock();
+}
+
+/** Restores the step size models of an ANC150 controller and keeps them saved.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName The asyn port name given to ANC150CreateController
+  * \param[in] fileName The model file; it is created when the models are first learnt
+  */
+extern "C" int ANC150LoadStepModel(const char *portName, const char *fileName)
+{
+  ANC150Controller *pC;
+  asynStatus status;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150LoadStepModel: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  if (!fileName || !fileName[0]) {
+    printf("ANC150LoadStepModel: a file name is required\n");
+    return(asynError);
+  }
+  pC->lock();
+  status = pC->loadStepModel(fileName);
+  pC->unlock();
+  return(status);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150LoadStepModelArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150LoadStepModelArg1 = {"File name", iocshArgString};
+static const iocshArg * const ANC150LoadStepModelArgs[] = {&ANC150LoadStepModelArg0,
+                                                           &ANC150LoadStepModelArg1};
+static const iocshFuncDef ANC150LoadStepModelDef = {"ANC150LoadStepModel", 2, ANC150LoadStepModelArgs};
+static void ANC150LoadStepModelCallFunc(const iocshArgBuf *args)
+{
+  ANC150LoadStepModel(args[0].sval, args[1].sval);
+}
+
+static void ANC150StepModelRegister(void)
+{
+  iocshRegister(&ANC150LoadStepModelDef, ANC150LoadStepModelCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150StepModelRegister);
+}
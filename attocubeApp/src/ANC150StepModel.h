@@ -0,0 +1,34 @@
+/*
+FILENAME...     ANC150StepModel.h
+USAGE...        Per-direction step size model for the attocube systems AG ANC150
+                Piezo Step Controller.
+
+*/
+
+#ifndef ANC150StepModel_H
+#define ANC150StepModel_H
+
+/* Frequency bins of the model; upper edges in Hz are 10, 30, 100, 300, 1000,
+ * 2000, 4000 and the last bin holds everything faster. */
+#define ANC150_MODEL_BINS 8
+#define ANC150_MODEL_GAIN_MIN 0.1   /* Range of plausible measured steps per commanded step */
+#define ANC150_MODEL_GAIN_MAX 10.0
+
+/** Step size of one direction in one frequency bin. */
+typedef struct ANC150StepGain {
+  double gain;                /* Measured steps per commanded step. */
+  int samples;                /* Measurements averaged into gain; 0 if none. */
+} ANC150StepGain;
+
+/** Step size model of an axis, down [0] and up [1]. */
+typedef struct ANC150StepModel {
+  ANC150StepGain bins[2][ANC150_MODEL_BINS];
+} ANC150StepModel;
+
+void ANC150ModelInit(ANC150StepModel *pModel);
+double ANC150ModelGain(const ANC150StepModel *pModel, bool up, int frequency);
+bool ANC150ModelUpdate(ANC150StepModel *pModel, bool up, int frequency, double gain);
+int ANC150ModelLoad(const char *fileName, ANC150StepModel *pModels, int nAxes, int *pNRejected);
+int ANC150ModelSave(const char *fileName, const ANC150StepModel *pModels, int nAxes);
+
+#endif /* ANC150StepModel_H */
@@ -0,0 +1,150 @@
+/*
+FILENAME...     ANC150Timeout.cpp
+USAGE...        Adaptive I/O timeouts for the attocube systems AG ANC150
+                Piezo Step Controller.
+
+*/
+
+/*
+ * A fixed timeout has to cover the slowest link an ANC150 is ever connected
+ * through, so on a local serial line a lost prompt stalls the poll for far
+ * longer than any real reply takes.  Each controller instead keeps the last
+ * ANC150_RTT_WINDOW round trip times of every timeout class and waits
+ * ANC150_RTT_FACTOR times their ANC150_RTT_PERCENTILE, plus a margin, bounded
+ * by the class's minimum and maximum.  Until ANC150_RTT_MIN_SAMPLES replies
+ * have been timed the maximum is used.  A transaction that times out doubles
+ * the timeout, so a link that has become slower is relearnt rather than
+ * declared down; the next replies bring it back to the percentile.
+ *
+ * Commands are either short or long (ANC150CommandDef.timeoutClass); the long
+ * class, the "ver" handshake, has its own window and maximum.
+ * A pipelined burst is timed once, by the read of its first frame; the
+ * later frames follow it on the wire and say nothing of the round trip.  The
+ * default minimum covers the wire time of a full frame at the port's baud
+ * rate.  ANC150ConfigTimeouts(portName, minTimeout, maxTimeout, longTimeout)
+ * sets the bounds.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <iocsh.h>
+
+#include "ANC150Driver.h"
+#include <epicsExport.h>
+
+/** Empties the window; the timeout is the maximum until it refills.
+  * \param[in] minTimeout, maxTimeout The bounds of the timeout (sec). */
+void ANC150RttInit(ANC150Rtt *pRtt, double minTimeout, double maxTimeout)
+{
+  pRtt->next = pRtt->count = 0;
+  pRtt->minTimeout = minTimeout;
+  pRtt->maxTimeout = maxTimeout;
+  pRtt->percentile = 0.0;
+  pRtt->timeout = maxTimeout;
+  pRtt->expired = 0;
+}
+
+/** Adds a round trip time to the window and recomputes the timeout.
+  * \param[in] rtt The time from the request to its reply (sec). */
+void ANC150RttSample(ANC150Rtt *pRtt, double rtt)
+{
+  double sorted[ANC150_RTT_WINDOW];
+  double value;
+  int i, j;
+
+  pRtt->samples[pRtt->next] = rtt;
+  pRtt->next = (pRtt->next + 1) % ANC150_RTT_WINDOW;
+  if (pRtt->count < ANC150_RTT_WINDOW)
+    pRtt->count++;
+  if (pRtt->count < ANC150_RTT_MIN_SAMPLES)
+    return;
+
+  /* Insertion sort; the window is small. */
+  for (i=0; i<pRtt->count; i++) {
+    value = pRtt->samples[i];
+    for (j=i; j>0 && sorted[j - 1] > value; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = value;
+  }
+  pRtt->percentile = sorted[(int) (ANC150_RTT_PERCENTILE * (pRtt->count - 1))];
+  pRtt->timeout = ANC150_RTT_FACTOR * pRtt->percentile + ANC150_RTT_MARGIN;
+  if (pRtt->timeout < pRtt->minTimeout)
+    pRtt->timeout = pRtt->minTimeout;
+  if (pRtt->timeout > pRtt->maxTimeout)
+    pRtt->timeout = pRtt->maxTimeout;
+}
+
+/** Doubles the timeout, up to the maximum, after a transaction timed out. */
+void ANC150RttExpired(ANC150Rtt *pRtt)
+{
+  pRtt->expired++;
+  pRtt->timeout *= 2;
+  if (pRtt->timeout > pRtt->maxTimeout)
+    pRtt->timeout = pRtt->maxTimeout;
+}
+
+/** Sets the bounds of the adaptive timeouts and restarts their measurement.
+  * \param[in] minTimeout The shortest timeout of any transaction (sec).
+  * \param[in] maxTimeout The longest timeout of short transactions (sec).
+  * \param[in] longTimeout The longest timeout of long transactions (sec). */
+void ANC150Controller::configTimeouts(double minTimeout, double maxTimeout, double longTimeout)
+{
+  epicsMutexLock(ioLock_);
+  ANC150RttInit(&rtt_[ANC150TimeoutShort], minTimeout, maxTimeout);
+  ANC150RttInit(&rtt_[ANC150TimeoutLong], minTimeout, longTimeout);
+  epicsMutexUnlock(ioLock_);
+}
+
+/** Sets the bounds of the adaptive I/O timeouts of a controller.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName The asyn port name given to ANC150CreateController
+  * \param[in] minTimeout The shortest timeout in ms of any transaction; 0 for the default, the wire
+  *                       time of a full frame at the port's baud rate and at least 20
+  * \param[in] maxTimeout The longest timeout in ms of short transactions; 0 for the default of the model
+  *                       (2000 for the ANC150, 1000 for the ANC300)
+  * \param[in] longTimeout The longest timeout in ms of long transactions ("ver"); 0 for the default (5000)
+  */
+extern "C" int ANC150ConfigTimeouts(const char *portName, double minTimeout, double maxTimeout, double longTimeout)
+{
+  ANC150Controller *pC;
+
+  pC = dynamic_cast<ANC150Controller *>((asynPortDriver *) findAsynPortDriver(portName));
+  if (!pC) {
+    printf("ANC150ConfigTimeouts: %s is not an ANC150 controller port\n", portName ? portName : "(null)");
+    return(asynError);
+  }
+  minTimeout = (minTimeout > 0) ? minTimeout / 1000. : pC->minTimeout();
+  maxTimeout = (maxTimeout > 0) ? maxTimeout / 1000. : pC->protocol()->maxTimeout;
+  longTimeout = (longTimeout > 0) ? longTimeout / 1000. : ANC150_LONG_TIMEOUT;
+  if (maxTimeout < minTimeout || longTimeout < minTimeout) {
+    printf("ANC150ConfigTimeouts: the maximum timeouts must not be less than the minimum\n");
+    return(asynError);
+  }
+  pC->configTimeouts(minTimeout, maxTimeout, longTimeout);
+  return(asynSuccess);
+}
+
+/** Code for iocsh registration */
+static const iocshArg ANC150ConfigTimeoutsArg0 = {"Port name", iocshArgString};
+static const iocshArg ANC150ConfigTimeoutsArg1 = {"Minimum timeout (msec)", iocshArgDouble};
+static const iocshArg ANC150ConfigTimeoutsArg2 = {"Maximum timeout (msec)", iocshArgDouble};
+static const iocshArg ANC150ConfigTimeoutsArg3 = {"Long command timeout (msec)", iocshArgDouble};
+static const iocshArg * const ANC150ConfigTimeoutsArgs[] = {&ANC150ConfigTimeoutsArg0,
+                                                            &ANC150ConfigTimeoutsArg1,
+                                                            &ANC150ConfigTimeoutsArg2,
+                                                            &ANC150ConfigTimeoutsArg3};
+static const iocshFuncDef ANC150ConfigTimeoutsDef = {"ANC150ConfigTimeouts", 4, ANC150ConfigTimeoutsArgs};
+static void ANC150ConfigTimeoutsCallFunc(const iocshArgBuf *args)
+{
+  ANC150ConfigTimeouts(args[0].sval, args[1].dval, args[2].dval, args[3].dval);
+}
+
+static void ANC150TimeoutRegister(void)
+{
+  iocshRegister(&ANC150ConfigTimeoutsDef, ANC150ConfigTimeoutsCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(ANC150TimeoutRegister);
+}
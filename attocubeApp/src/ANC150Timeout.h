@@ -0,0 +1,33 @@
+/*
+FILENAME...     ANC150Timeout.h
+USAGE...        Adaptive I/O timeouts for the attocube systems AG ANC150
+                Piezo Step Controller.
+
+*/
+
+#ifndef ANC150Timeout_H
+#define ANC150Timeout_H
+
+#define ANC150_RTT_WINDOW 64        /* Round trip times the timeout is computed from */
+#define ANC150_RTT_MIN_SAMPLES 8    /* Round trip times needed before the timeout adapts */
+#define ANC150_RTT_PERCENTILE 0.99
+#define ANC150_RTT_FACTOR 3.0       /* Timeout = factor * percentile + margin */
+#define ANC150_RTT_MARGIN 0.01
+
+/** Round trip times of one timeout class and the timeout derived from them. */
+typedef struct ANC150Rtt {
+  double samples[ANC150_RTT_WINDOW];
+  int next;                   /* Slot for the next sample. */
+  int count;                  /* Samples in the window. */
+  double minTimeout;          /* Bounds of the timeout (sec). */
+  double maxTimeout;
+  double percentile;          /* ANC150_RTT_PERCENTILE of the window (sec). */
+  double timeout;             /* Timeout of the next transaction (sec). */
+  int expired;                /* Transactions that timed out. */
+} ANC150Rtt;
+
+void ANC150RttInit(ANC150Rtt *pRtt, double minTimeout, double maxTimeout);
+void ANC150RttSample(ANC150Rtt *pRtt, double rtt);
+void ANC150RttExpired(ANC150Rtt *pRtt);
+
+#endif /* ANC150Timeout_H */
@@ -0,0 +1,199 @@
+/*
+FILENAME...     ANC150ParserTest.cpp
+USAGE...        Unit tests of the attocube systems AG ANC150 reply framing
+                and parsing (ANC150Parser.cpp).
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include "ANC150Parser.h"
+
+#define NUM_RANDOM_FRAMES 100000
+
+/** Parses a NUL terminated frame and decodes its reply for a command.
+  * \return The number of bytes ANC150ParseFrame() consumed; 0 if the frame is incomplete. */
+static size_t parse(const char *command, const char *buffer, ANC150Result *pResult)
+{
+  ANC150Frame frame;
+  size_t len;
+
+  len = ANC150ParseFrame(buffer, strlen(buffer), &frame);
+  if (len)
+    ANC150ParseReply(ANC150FindCommand(command), &frame, pResult);
+  return(len);
+}
+
+/** true if a view lies within the first len bytes of buffer. */
+static bool inside(const ANC150View *pView, const char *buffer, size_t len)
+{
+  return(pView->ptr >= buffer && pView->ptr + pView->len <= buffer + len);
+}
+
+static void testFrames()
+{
+  ANC150Result result;
+
+  testDiag("Complete frames");
+  testOk(parse("getf 1", "getf 1\r\nfrequency = 1000\r\nOK\r\n> ", &result) == 30 &&
+         result.code == ANC150ResultOK && result.value == 1000, "getf reply");
+  testOk(parse("getf 1", "getf 1\r\nfrequency = 1000 Hz\r\nOK\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultOK && result.value == 1000, "getf reply with a unit");
+  testOk(parse("getm 1", "getm 1\r\nmode = stp\r\nOK\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultOK && result.value == 1, "getm stp");
+  testOk(parse("getm 1", "getm 1\r\nmode = gnd\r\nOK\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultOK && result.value == 0, "getm gnd");
+  testOk(parse("setf 1 100", "setf 1 100\r\nOK\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultOK, "setter without a reply line");
+  testOk(parse("ver", "ver\r\nattocube ANC300 controller version 1.0\r\n2 modules\r\nOK\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultOK && strcmp(result.text, "attocube ANC300 controller version 1.0") == 0,
+         "multi-line ver reply");
+  testOk(parse("stop 1", "stop 1\r\nAxis not in computer control mode\r\nERROR\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultNotInControl, "axis not in computer control mode");
+  testOk(parse("setf 1 0", "setf 1 0\r\nValue out of range\r\nERROR\r\n> ", &result) != 0 &&
+         result.code == ANC150ResultError, "ERROR acknowledge");
+}
+
+static void testTruncated()
+{
+  static const char full[] = "getf 1\r\nfrequency = 1000\r\nOK\r\n> ";
+  char buffer[sizeof(full)];
+  ANC150Frame frame;
+  size_t len, n;
+  bool bounded = true, incomplete = true;
+
+  testDiag("Truncated frames");
+  for (len=0; len<sizeof(full); len++) {
+    memcpy(buffer, full, len);
+    n = ANC150ParseFrame(buffer, len, &frame);
+    if (n > len)
+      bounded = false;
+    /* Fewer than two complete lines is not a frame. */
+    if (len < strlen("getf 1\r\nfrequency = 1000\r\n") && n != 0)
+      incomplete = false;
+  }
+  testOk(bounded, "never consumes more than the buffer");
+  testOk(incomplete, "frames of fewer than two lines are incomplete");
+}
+
+static void testMissingAck()
+{
+  ANC150Result result;
+
+  testDiag("Missing acknowledge");
+  testOk(parse("getf 1", "getf 1\r\n", &result) == 0, "echo only");
+  testOk(parse("getf 1", "getf 1\r\nfrequency = 1000", &result) == 0, "unterminated reply line");
+  testOk(parse("getf 1", "getf 1\r\nfrequency = 1000\r\n", &result) != 0 &&
+         result.code == ANC150ResultBadReply, "reply line taken as the acknowledge is a bad reply");
+}
+
+static void testNonNumeric()
+{
+  ANC150Result result;
+
+  testDiag("Non-numeric and out of range integers");
+  parse("getf 1", "getf 1\r\nfrequency = abc\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "letters");
+  parse("getf 1", "getf 1\r\nfrequency = 12x4\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "trailing garbage");
+  parse("getf 1", "getf 1\r\nfrequency = -\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "sign only");
+  parse("getf 1", "getf 1\r\nfrequency = \r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "empty value");
+  parse("getf 1", "getf 1\r\nfrequency =  Hz\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "unit without a value");
+  parse("getf 1", "getf 1\r\nfreq = 1000\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "wrong prefix");
+  parse("getm 1", "getm 1\r\nmode = stpx\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "unknown mode");
+  parse("getf 1", "getf 1\r\nfrequency = 2147483647\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultOK && result.value == INT_MAX, "INT_MAX");
+  parse("getf 1", "getf 1\r\nfrequency = -2147483647\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultOK && result.value == -INT_MAX, "-INT_MAX");
+  parse("getf 1", "getf 1\r\nfrequency = 2147483648\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "INT_MAX + 1");
+  parse("getf 1", "getf 1\r\nfrequency = 99999999999999999999999999999999\r\nOK\r\n> ", &result);
+  testOk(result.code == ANC150ResultBadReply, "long run of digits");
+}
+
+static void testOversized()
+{
+  char buffer[4096];
+  ANC150Result result;
+  int len;
+
+  testDiag("Oversized frames");
+  len = sprintf(buffer, "ver\r\n");
+  memset(&buffer[len], 'x', 3000);
+  len += 3000;
+  sprintf(&buffer[len], "\r\nOK\r\n> ");
+  testOk(parse("ver", buffer, &result) != 0 && result.code == ANC150ResultOK &&
+         strlen(result.text) == sizeof(result.text) - 1, "text reply truncated to the result size");
+
+  len = sprintf(buffer, "getf 1\r\nfrequency = ");
+  memset(&buffer[len], '7', 3000);
+  len += 3000;
+  sprintf(&buffer[len], "\r\nOK\r\n> ");
+  testOk(parse("getf 1", buffer, &result) != 0 && result.code == ANC150ResultBadReply,
+         "3000 digit integer");
+}
+
+static void testRandom()
+{
+  static const char *commands[] = {"ver", "getf 1", "getm 1", "setf 1 100", "stepu 1 10", "stop 1", "bogus 1"};
+  static const char alphabet[] = "\r\n0123456789- =frequncymodstpgnOKERHz>";
+  char buffer[128];
+  unsigned int seed = 12345;
+  ANC150Frame frame;
+  ANC150Result result;
+  size_t len, n, i;
+  int k, bad = 0, decoded = 0;
+
+  testDiag("%d random frames", NUM_RANDOM_FRAMES);
+  for (k=0; k<NUM_RANDOM_FRAMES; k++) {
+    seed = seed * 1103515245 + 12345;
+    len = (seed >> 16) % sizeof(buffer);
+    /* Mostly printable characters of replies with a line end every 8 characters on
+     * average, so most buffers hold a few lines; some bytes are arbitrary. */
+    for (i=0; i<len; i++) {
+      seed = seed * 1103515245 + 12345;
+      if ((seed >> 8) % 8 == 0 && i + 1 < len) {
+        buffer[i++] = '\r';
+        buffer[i] = '\n';
+      }
+      else
+        buffer[i] = ((seed >> 12) % 16) ? alphabet[(seed >> 16) % (sizeof(alphabet) - 1)] : (char) (seed >> 16);
+    }
+    n = ANC150ParseFrame(buffer, len, &frame);
+    if (n == 0)
+      continue;
+    if (n > len || !inside(&frame.echo, buffer, len) || !inside(&frame.reply, buffer, len) ||
+        !inside(&frame.ack, buffer, len)) {
+      bad++;
+      continue;
+    }
+    ANC150ParseReply(ANC150FindCommand(commands[k % (sizeof(commands) / sizeof(commands[0]))]), &frame, &result);
+    if (memchr(result.text, 0, sizeof(result.text)) == NULL)
+      bad++;
+    decoded++;
+  }
+  testOk(bad == 0, "views within the buffer and text terminated (%d of %d frames decoded)",
+         decoded, NUM_RANDOM_FRAMES);
+}
+
+MAIN(ANC150ParserTest)
+{
+  testPlan(27);
+  testFrames();
+  testTruncated();
+  testMissingAck();
+  testNonNumeric();
+  testOversized();
+  testRandom();
+  return testDone();
+}
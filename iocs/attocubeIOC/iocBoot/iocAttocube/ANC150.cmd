@@ -1,4 +1,3 @@
-
 drvAsynSerialPortConfigure("serial1","/dev/ttyS0",0,0,0)
 #!asynSetOption("serial", -1, "baud", "38400")
 #!asynOctetSetInputEos("serial1",0,"")
@@ -6,13 +5,63 @@ drvAsynSerialPortConfigure("serial1","/dev/ttyS0",0,0,0)
 
 dbLoadTemplate("ANC150.substitutions")
 
-# attocube ANC 150 asyn motor driver setup parameter.
-ANC150AsynSetup(1)  /* number of ANC150 controllers in system.  */
+# With many controllers, share a few poller threads among all the controllers
+# created after this command instead of starting one thread per controller.
+#     (1) Number of poller threads
+#!ANC150CreatePollerPool(4)
 
-# attocube ANC 150 asyn motor driver configure parameters.
-#     (1) Controller number being configured
-#     (2) ASYN port name
+# attocube ANC 150 asyn motor driver (model 3) configure parameters.
+#     (1) Asyn port name created for this controller
+#     (2) ASYN serial port name
 #     (3) Number of axes this controller supports
 #     (4) Time to poll (msec) when an axis is in motion
 #     (5) Time to poll (msec) when an axis is idle. 0 for no polling
-ANC150AsynConfig(0, "serial1", 3, 250, 2000)
+#     (6) Time (msec) between re-reads of cached frequency and mode. 0 for default (10 sec)
+#     (7) Time (msec) between position updates of moving axes, made without serial I/O. 0 for none
+ANC150CreateController("ANC150", "serial1", 3, 250, 2000, 10000, 40)
+
+# attocube ANC300, over TCP (telnet port 7230); same parameters, up to 7 axes (modules).
+#!drvAsynIPPortConfigure("tcp1", "192.168.1.2:7230", 0, 0, 0)
+#!ANC300CreateController("ANC300", "tcp1", 7, 100, 2000, 10000, 40)
+
+# Bounds of the I/O timeouts, which adapt to the measured round trip times.
+#     (1) Asyn port name given to ANC150CreateController
+#     (2) Shortest timeout (msec); 0 for the default, the wire time of a 100 character
+#         frame at the port's baud rate (104 at 9600 baud) and at least 20
+#     (3) Longest timeout (msec); 0 for the default (2000)
+#     (4) Longest timeout (msec) of long commands ("ver"); 0 for the default (5000)
+#!ANC150ConfigTimeouts("ANC150", 20, 2000, 5000)
+
+# Position journal: the positions survive IOC restarts without waiting for autosave.
+#     (1) Asyn port name given to ANC150CreateController
+#     (2) Journal file
+#!ANC150OpenJournal("ANC150", "ANC150.journal")
+
+# Latest-wins move mailbox: moves are sent by a dispatcher thread, and a move that
+# is not sent yet is replaced by a newer one (slider drags, feedback loops).
+#     (1) Asyn port name given to ANC150CreateController
+#!ANC150CreateMailbox("ANC150")
+
+# Driver statistics (command latency histograms, transport counters, poll timing).
+dbLoadRecords("$(MOTOR_ATTOCUBE)/db/ANC150Stats.template", "P=attocube:,R=ANC150:,PORT=ANC150")
+
+# Step size models (up/down step size per frequency), learnt by closed-loop axes
+# and used to size every move; restored from and saved to the file.
+#     (1) Asyn port name given to ANC150CreateController
+#     (2) Model file
+#!ANC150LoadStepModel("ANC150", "ANC150StepModel.txt")
+
+# Coordinated moves: the motor records' DEFER field, or from the shell after iocInit;
+#   ANC150GroupMove("ANC150", "0,1,2", "100,200,-50", 1)   - port, axes, positions (steps), relative
+# Axis status without taking the controller lock, also while a poll hangs:
+#   ANC150Status("ANC150")
+# Trace messages are written by a background thread; limit them to errors and flow, and show the drop count:
+#   ANC150LogMask(0x11)
+
+# Profile moves, streamed from the IOC as timed step bursts.
+#     (1) Asyn port name given to ANC150CreateController
+#     (2) Maximum number of profile points
+#!ANC150CreateProfile("ANC150", 2000)
+#!dbLoadRecords("$(MOTOR)/db/profileMoveController.template", "P=attocube:,R=Prof1:,PORT=ANC150,NAXES=3,NPOINTS=2000,NPULSES=2000,TIMEOUT=1")
+#!dbLoadRecords("$(MOTOR)/db/profileMoveAxis.template", "P=attocube:,R=Prof1:,M=M1,PORT=ANC150,ADDR=0,NPOINTS=2000,NREADBACK=2000,PREC=0,TIMEOUT=1")
+#!dbLoadRecords("$(MOTOR_ATTOCUBE)/db/ANC150Profile.template", "P=attocube:,R=Prof1:,PORT=ANC150,NPOINTS=2000")
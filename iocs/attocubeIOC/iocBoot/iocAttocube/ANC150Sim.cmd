@@ -0,0 +1,37 @@
+# Simulated attocube ANC 150 controller parameters.
+#     (1) ASYN port name created for the simulator
+#     (2) Number of axes the simulated controller has
+#     (3) Baud rate used to model wire delay. 0 for no delay
+ANC150SimConfig("serial1", 3, 9600)
+
+dbLoadTemplate("ANC150.substitutions")
+
+# attocube ANC 150 asyn motor driver (model 3) configure parameters; see ANC150.cmd.
+ANC150CreateController("ANC150", "serial1", 3, 250, 2000, 10000, 40)
+
+# Simulated ANC300, served on TCP port 7230 of the loopback interface as a stand-in
+# for the controller's telnet port; parameters are port name, number of axes, TCP port.
+#!ANC300SimConfig("sim300", 7, 7230)
+#!drvAsynIPPortConfigure("tcp1", "localhost:7230", 0, 0, 0)
+#!ANC300CreateController("ANC300", "tcp1", 7, 100, 2000, 10000, 40)
+
+# Driver statistics (command latency histograms, transport counters, poll timing).
+dbLoadRecords("$(MOTOR_ATTOCUBE)/db/ANC150Stats.template", "P=attocube:,R=ANC150:,PORT=ANC150")
+
+# Closed-loop positioning from the simulator's actual axis positions; see ANC150Feedback.cpp.
+#     ANC150ConfigFeedback(port, axis, source port, source addr, drvInfo, steps per unit,
+#                          tolerance (steps), max iterations, settle time (ms))
+#   ANC150SimStepSize("serial1", 1, 0.9, 1.15)
+#   ANC150SimSensor("sensor1", "serial1")
+#   ANC150ConfigFeedback("ANC150", 0, "sensor1", 0, "", 1.0, 0.5, 8, 20)
+
+# Fault injection:
+#   ANC150SimControlMode("serial1", 2, 0)  - axis 2 not in computer control mode
+#   ANC150SimTimeouts("serial1", 4)        - leave the next 4 commands unanswered
+
+# Driver benchmark (devAttocubeBench.dbd, AttocubeBench library); run after
+# iocInit, results are written as JSON.
+#   benchANC150("ANC150", 100, "ANC150Bench.json")
+# Poller scaling with 1, 10 and 50 simulated controllers; 4 pool workers (0 for a
+# thread per controller), 10 sec per size.
+#   benchANC150Scale(4, 10, "ANC150Scale.json")
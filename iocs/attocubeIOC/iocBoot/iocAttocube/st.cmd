@@ -15,9 +15,14 @@ dbLoadRecords("$(MOTOR)/db/motorUtil.db", "P=attocube:")
 
 ##
 < ANC150.cmd
+## Simulated ANC150 controller; use instead of ANC150.cmd when no hardware is available
+#!< ANC150Sim.cmd
 
 iocInit
 
+## Wait up to 10 sec for the ANC150 controllers and print how long each took to be ready
+ANC150StartupSummary(10)
+
 ## motorUtil (allstop & alldone)
 motorUtilInit("attocube:")
 
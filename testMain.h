@@ -0,0 +1 @@
+#define MAIN(x) int main()